@@ -0,0 +1,191 @@
+#include "CoefficientDesigner.h"
+
+namespace
+{
+    enum Band
+    {
+        LowCutBand,
+        PeakBand,
+        HighCutBand,
+        NumBands
+    };
+
+    const juce::StringArray bandParameterIDs
+    {
+        "LowCut Freq", "LowCut Slope", "LowCut Bypassed", "LowCut Topology",
+        "Peak Freq", "Peak Gain", "Peak Quality", "Peak Design", "Peak Bypassed", "Peak Topology",
+        "HighCut Freq", "HighCut Slope", "HighCut Bypassed", "HighCut Topology"
+    };
+
+    int getBandForParameter(const juce::String& parameterID)
+    {
+        if (parameterID.startsWith("LowCut"))
+            return LowCutBand;
+        if (parameterID.startsWith("Peak"))
+            return PeakBand;
+        if (parameterID.startsWith("HighCut"))
+            return HighCutBand;
+
+        return -1;
+    }
+}
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+{
+    return ChainParameters(apvts).load();
+}
+
+ChainParameters::ChainParameters(juce::AudioProcessorValueTreeState& apvts)
+    : lowCutFreq(apvts.getRawParameterValue("LowCut Freq")),
+      highCutFreq(apvts.getRawParameterValue("HighCut Freq")),
+      peakFreq(apvts.getRawParameterValue("Peak Freq")),
+      peakGainInDecibels(apvts.getRawParameterValue("Peak Gain")),
+      peakQuality(apvts.getRawParameterValue("Peak Quality")),
+      peakDesign(apvts.getRawParameterValue("Peak Design")),
+      lowCutSlope(apvts.getRawParameterValue("LowCut Slope")),
+      highCutSlope(apvts.getRawParameterValue("HighCut Slope")),
+      lowCutBypassed(apvts.getRawParameterValue("LowCut Bypassed")),
+      peakBypassed(apvts.getRawParameterValue("Peak Bypassed")),
+      highCutBypassed(apvts.getRawParameterValue("HighCut Bypassed")),
+      lowCutTopology(apvts.getRawParameterValue("LowCut Topology")),
+      peakTopology(apvts.getRawParameterValue("Peak Topology")),
+      highCutTopology(apvts.getRawParameterValue("HighCut Topology"))
+{
+}
+
+ChainSettings ChainParameters::load() const
+{
+    ChainSettings settings;
+    settings.lowCutFreq = lowCutFreq->load();
+    settings.highCutFreq = highCutFreq->load();
+    settings.peakFreq = peakFreq->load();
+    settings.peakGainInDecibels = peakGainInDecibels->load();
+    settings.peakQuality = peakQuality->load();
+    settings.peakDesign = static_cast<PeakDesign>(peakDesign->load());
+    settings.lowCutSlope = static_cast<Slope>(lowCutSlope->load());
+    settings.highCutSlope = static_cast<Slope>(highCutSlope->load());
+
+    settings.lowCutBypassed = lowCutBypassed->load() > 0.5f;
+    settings.peakBypassed = peakBypassed->load() > 0.5f;
+    settings.highCutBypassed = highCutBypassed->load() > 0.5f;
+
+    settings.lowCutTopology = static_cast<SectionTopology>(lowCutTopology->load());
+    settings.peakTopology = static_cast<SectionTopology>(peakTopology->load());
+    settings.highCutTopology = static_cast<SectionTopology>(highCutTopology->load());
+    return settings;
+}
+
+//==============================================================================
+CoefficientDesigner::CoefficientDesigner(juce::AudioProcessorValueTreeState& state)
+    : apvts(state), chainParameters(state)
+{
+    for (auto& id : bandParameterIDs)
+        apvts.addParameterListener(id, this);
+
+    designThread->addTimeSliceClient(this);
+}
+
+CoefficientDesigner::~CoefficientDesigner()
+{
+    designThread->removeTimeSliceClient(this);
+
+    for (auto& id : bandParameterIDs)
+        apvts.removeParameterListener(id, this);
+}
+
+void CoefficientDesigner::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate);
+    designPendingChanges();
+}
+
+bool CoefficientDesigner::designPendingChanges()
+{
+    const juce::ScopedLock sl(designLock);
+
+    auto rate = sampleRate.load();
+    if (rate <= 0.0)
+        return false;
+
+    const bool rateChanged = ! juce::exactlyEqual(rate, designed.sampleRate);
+
+    static_assert((size_t)NumBands == numBands, "band enum and version arrays must agree");
+
+    std::array<bool, NumBands> dirty{};
+    bool anyDirty = false;
+
+    for (size_t band = 0; band < bandVersions.size(); ++band)
+    {
+        // Read the version before the values: the value is stored before the
+        // listener bumps the version, so a stale value can never be designed
+        // under a fresh version.
+        auto version = bandVersions[band].load(std::memory_order_acquire);
+        dirty[band] = rateChanged || version != designedBandVersions[band];
+        designedBandVersions[band] = version;
+        anyDirty = anyDirty || dirty[band];
+    }
+
+    if (!anyDirty)
+        return false;
+
+    auto chainSettings = chainParameters.load();
+    designed.sampleRate = rate;
+
+    if (dirty[LowCutBand])
+    {
+        makeLowCutFilter(chainSettings, rate, designed.lowCut);
+        designed.lowCutSlope = chainSettings.lowCutSlope;
+        designed.lowCutBypassed = chainSettings.lowCutBypassed;
+        designed.lowCutTopology = chainSettings.lowCutTopology;
+        designed.lowCutFlat = isFlat(designed.lowCut.data(), getNumCutSections(designed.lowCutSlope), rate);
+    }
+
+    if (dirty[PeakBand])
+    {
+        designed.peak = makePeakFilter(chainSettings, rate);
+        designed.peakBypassed = chainSettings.peakBypassed;
+        designed.peakTopology = chainSettings.peakTopology;
+        designed.peakFlat = isFlat(&designed.peak, 1, rate);
+    }
+
+    if (dirty[HighCutBand])
+    {
+        makeHighCutFilter(chainSettings, rate, designed.highCut);
+        designed.highCutSlope = chainSettings.highCutSlope;
+        designed.highCutBypassed = chainSettings.highCutBypassed;
+        designed.highCutTopology = chainSettings.highCutTopology;
+        designed.highCutFlat = isFlat(designed.highCut.data(), getNumCutSections(designed.highCutSlope), rate);
+    }
+
+    audioMailbox.getWriteBuffer() = designed;
+    audioMailbox.publish();
+
+    editorMailbox.getWriteBuffer() = designed;
+    editorMailbox.publish();
+
+    linearPhaseMailbox.getWriteBuffer() = designed;
+    linearPhaseMailbox.publish();
+
+    return true;
+}
+
+void CoefficientDesigner::parameterChanged(const juce::String& parameterID, float)
+{
+    auto band = getBandForParameter(parameterID);
+    if (band >= 0)
+        bandVersions[(size_t)band].fetch_add(1, std::memory_order_release);
+}
+
+int CoefficientDesigner::useTimeSlice()
+{
+    const auto now = juce::Time::getMillisecondCounter();
+    const auto sinceLastDesign = (int)(now - lastDesignTime);
+
+    if (sinceLastDesign < minDesignIntervalMs)
+        return minDesignIntervalMs - sinceLastDesign;
+
+    if (designPendingChanges())
+        lastDesignTime = now;
+
+    return pollIntervalMs;
+}
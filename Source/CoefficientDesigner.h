@@ -0,0 +1,109 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include "FilterDesign.h"
+#include "TripleBuffer.h"
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+
+/**
+ Raw parameter values looked up once by ID, so nothing on a hot path ever
+ has to search the value tree by string to build a ChainSettings.
+ */
+struct ChainParameters
+{
+    explicit ChainParameters(juce::AudioProcessorValueTreeState& apvts);
+
+    ChainSettings load() const;
+
+    std::atomic<float>* lowCutFreq = nullptr;
+    std::atomic<float>* highCutFreq = nullptr;
+    std::atomic<float>* peakFreq = nullptr;
+    std::atomic<float>* peakGainInDecibels = nullptr;
+    std::atomic<float>* peakQuality = nullptr;
+    std::atomic<float>* peakDesign = nullptr;
+    std::atomic<float>* lowCutSlope = nullptr;
+    std::atomic<float>* highCutSlope = nullptr;
+    std::atomic<float>* lowCutBypassed = nullptr;
+    std::atomic<float>* peakBypassed = nullptr;
+    std::atomic<float>* highCutBypassed = nullptr;
+    std::atomic<float>* lowCutTopology = nullptr;
+    std::atomic<float>* peakTopology = nullptr;
+    std::atomic<float>* highCutTopology = nullptr;
+};
+
+/**
+ The one place filter coefficients get designed.
+
+ Parameter changes bump a per-band version from whichever thread set them.
+ A thread shared by every instance in the process polls those versions,
+ redesigns only the bands that moved and publishes the whole set to each of
+ its readers: the audio thread, the editor and the linear-phase kernel
+ designer. Each picks up the newest snapshot with a wait-free index swap and
+ never sees a half-written one.
+
+ However fast the parameters move, the thread designs at most once every
+ minDesignIntervalMs, so the cost is bounded whatever the host does; the
+ cascade ramps between the designs it is given.
+ */
+class CoefficientDesigner : private juce::AudioProcessorValueTreeState::Listener,
+                            private juce::TimeSliceClient
+{
+public:
+    /** The shortest time between two designs on the background thread: at most 250 a second. */
+    static constexpr int minDesignIntervalMs = 4;
+
+    explicit CoefficientDesigner(juce::AudioProcessorValueTreeState& apvts);
+    ~CoefficientDesigner() override;
+
+    /** Designs every band for the new rate and publishes it before returning. */
+    void prepare(double sampleRate);
+
+    /**
+     Has the background thread redesign every band for a new rate, e.g. when
+     the oversampling factor changes. Only stores the rate, so it is safe on
+     the audio thread.
+     */
+    void setDesignRate(double newSampleRate) { sampleRate.store(newSampleRate); }
+
+    /**
+     Designs and publishes any out-of-date bands on the calling thread, for when
+     the caller can't wait for the background thread, e.g. an offline render
+     running faster than real time. Returns true if anything was published.
+     */
+    bool designPendingChanges();
+
+    TripleBuffer<FilterCoefficientSet>& getAudioMailbox() { return audioMailbox; }
+    TripleBuffer<FilterCoefficientSet>& getEditorMailbox() { return editorMailbox; }
+    TripleBuffer<FilterCoefficientSet>& getLinearPhaseMailbox() { return linearPhaseMailbox; }
+private:
+    struct DesignThread : juce::TimeSliceThread
+    {
+        DesignThread() : juce::TimeSliceThread("PSPVST Coefficient Designer") { startThread(); }
+        ~DesignThread() override { stopThread(1000); }
+    };
+
+    static constexpr int pollIntervalMs = 2;
+    static constexpr size_t numBands = 3;
+
+    juce::AudioProcessorValueTreeState& apvts;
+    ChainParameters chainParameters;
+
+    std::array<std::atomic<juce::uint32>, numBands> bandVersions{};
+    std::array<juce::uint32, numBands> designedBandVersions{};
+    std::atomic<double> sampleRate{ 0.0 };
+    juce::uint32 lastDesignTime = 0;
+
+    juce::CriticalSection designLock;
+    FilterCoefficientSet designed;
+
+    TripleBuffer<FilterCoefficientSet> audioMailbox, editorMailbox, linearPhaseMailbox;
+
+    juce::SharedResourcePointer<DesignThread> designThread;
+
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    int useTimeSlice() override;
+
+    JUCE_DECLARE_NON_COPYABLE(CoefficientDesigner)
+};
@@ -0,0 +1,237 @@
+#include <juce_core/juce_core.h>
+
+#include "DspKernels.h"
+#include "FilterDesign.h"
+
+#include <atomic>
+#include <cmath>
+#include <iterator>
+
+TaskRunner::TaskRunner() = default;
+TaskRunner::~TaskRunner() = default;
+
+template<typename SampleType>
+FilterCascadeEngine<SampleType>::FilterCascadeEngine() = default;
+
+template<typename SampleType>
+FilterCascadeEngine<SampleType>::~FilterCascadeEngine() = default;
+
+template struct FilterCascadeEngine<float>;
+template struct FilterCascadeEngine<double>;
+
+template<typename SampleType>
+OversamplingEngine<SampleType>::OversamplingEngine() = default;
+
+template<typename SampleType>
+OversamplingEngine<SampleType>::~OversamplingEngine() = default;
+
+template struct OversamplingEngine<float>;
+template struct OversamplingEngine<double>;
+
+namespace
+{
+    constexpr SimdInstructionSet allInstructionSets[]
+    {
+        SimdInstructionSet::generic,
+        SimdInstructionSet::sse2,
+        SimdInstructionSet::avx2,
+        SimdInstructionSet::avx512
+    };
+
+    static_assert(std::size(allInstructionSets) == numInstructionSets);
+
+    constexpr int noForcedInstructionSet = -1;
+    std::atomic<int> forcedInstructionSet{ noForcedInstructionSet };
+
+    bool isSupportedByCpu(SimdInstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+            case SimdInstructionSet::generic: return true;
+            case SimdInstructionSet::sse2:    return juce::SystemStats::hasSSE2();
+            case SimdInstructionSet::avx2:    return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+            case SimdInstructionSet::avx512:  return juce::SystemStats::hasAVX512F();
+        }
+
+        return false;
+    }
+
+    const DspKernels* getBuiltInKernels(SimdInstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+            case SimdInstructionSet::generic: return getGenericDspKernels();
+            case SimdInstructionSet::sse2:    return getSse2DspKernels();
+            case SimdInstructionSet::avx2:    return getAvx2DspKernels();
+            case SimdInstructionSet::avx512:  return getAvx512DspKernels();
+        }
+
+        return nullptr;
+    }
+
+    const DspKernels* getForcedKernels()
+    {
+        auto forced = forcedInstructionSet.load(std::memory_order_relaxed);
+        return forced == noForcedInstructionSet ? nullptr : getDspKernels(static_cast<SimdInstructionSet>(forced));
+    }
+
+    // The x86 builds, narrowest first; generic only when none of them can run.
+    struct Candidates
+    {
+        Candidates()
+        {
+            for (auto instructionSet : allInstructionSets)
+                if (instructionSet != SimdInstructionSet::generic)
+                    if (auto* kernels = getDspKernels(instructionSet))
+                        list[numKernels++] = kernels;
+
+            if (numKernels == 0)
+                list[numKernels++] = getGenericDspKernels();
+        }
+
+        const DspKernels* list[std::size(allInstructionSets)]{};
+        int numKernels = 0;
+    };
+
+    const Candidates& getCandidates()
+    {
+        static const Candidates candidates;
+        return candidates;
+    }
+}
+
+CascadeSections packCascadeSections(const FilterCoefficientSet& coefficients)
+{
+    enum
+    {
+        lowCutSlot = 0,
+        peakSlot = lowCutSlot + maxCutSections,
+        highCutSlot = peakSlot + 1
+    };
+
+    CascadeSections packed{};
+
+    auto addSection = [&packed](int slot, SectionTopology topology, const BiquadCoefficients& c)
+    {
+        packed.sections[packed.numSections++] = { slot, topology, c, toStateVariable(c) };
+    };
+
+    if (coefficients.isLowCutActive())
+        for (int i = 0; i < getNumCutSections(coefficients.lowCutSlope); ++i)
+            addSection(lowCutSlot + i, coefficients.lowCutTopology, coefficients.lowCut[(size_t)i]);
+
+    if (coefficients.isPeakActive())
+        addSection(peakSlot, coefficients.peakTopology, coefficients.peak);
+
+    if (coefficients.isHighCutActive())
+        for (int i = 0; i < getNumCutSections(coefficients.highCutSlope); ++i)
+            addSection(highCutSlot + i, coefficients.highCutTopology, coefficients.highCut[(size_t)i]);
+
+    return packed;
+}
+
+bool needsStateVariable(const BiquadCoefficients& c)
+{
+    return std::abs(1.0 + c.a1 + c.a2) < minBiquadPoleDistance
+        || std::abs(1.0 - c.a1 + c.a2) < minBiquadPoleDistance;
+}
+
+double getOversamplingLatency(int factor)
+{
+    if (factor < 2)
+        return 0.0;
+
+    double first[firstHalfBandCoefficients];
+    makeHalfBandAllpass(first, firstHalfBandCoefficients, firstHalfBandTransition);
+    auto latency = getHalfBandLatency(first, firstHalfBandCoefficients);
+
+    // The second stage runs at twice the base rate.
+    if (factor > 2)
+    {
+        double second[secondHalfBandCoefficients];
+        makeHalfBandAllpass(second, secondHalfBandCoefficients, secondHalfBandTransition);
+        latency += getHalfBandLatency(second, secondHalfBandCoefficients) / 2.0;
+    }
+
+    return latency;
+}
+
+MagnitudeResponseSection makeMagnitudeResponseSection(const BiquadCoefficients& c)
+{
+    // |b0 + b1 z^-1 + b2 z^-2|^2 on the unit circle, and the same for 1 + a1 z^-1 + a2 z^-2.
+    return { c.b0 * c.b0 + c.b1 * c.b1 + c.b2 * c.b2,
+             2.0 * (c.b0 * c.b1 + c.b1 * c.b2),
+             2.0 * c.b0 * c.b2,
+             1.0 + c.a1 * c.a1 + c.a2 * c.a2,
+             2.0 * (c.a1 + c.a1 * c.a2),
+             2.0 * c.a2 };
+}
+
+int getAvailableInstructionSets(SimdInstructionSet* result)
+{
+    int num = 0;
+
+    for (auto instructionSet : allInstructionSets)
+        if (getDspKernels(instructionSet) != nullptr)
+            result[num++] = instructionSet;
+
+    return num;
+}
+
+const DspKernels* getDspKernels(SimdInstructionSet instructionSet)
+{
+    return isSupportedByCpu(instructionSet) ? getBuiltInKernels(instructionSet) : nullptr;
+}
+
+const DspKernels& getDspKernels()
+{
+    if (auto* forced = getForcedKernels())
+        return *forced;
+
+    const auto& candidates = getCandidates();
+    return *candidates.list[candidates.numKernels - 1];
+}
+
+const DspKernels& getDspKernelsForChannels(int numChannels, bool doublePrecision)
+{
+    if (auto* forced = getForcedKernels())
+        return *forced;
+
+    // Every group of lanes is a serial pass through the cascade, so the fewest
+    // groups wins; among equals the narrower registers avoid the clock
+    // penalty some CPUs pay for wide vectors.
+    const auto& candidates = getCandidates();
+
+    for (int i = 0; i < candidates.numKernels; ++i)
+        if ((doublePrecision ? candidates.list[i]->doubleLanes : candidates.list[i]->floatLanes) >= numChannels)
+            return *candidates.list[i];
+
+    return *candidates.list[candidates.numKernels - 1];
+}
+
+bool forceInstructionSet(SimdInstructionSet instructionSet)
+{
+    if (getDspKernels(instructionSet) == nullptr)
+        return false;
+
+    forcedInstructionSet.store(static_cast<int>(instructionSet), std::memory_order_relaxed);
+    return true;
+}
+
+void clearForcedInstructionSet()
+{
+    forcedInstructionSet.store(noForcedInstructionSet, std::memory_order_relaxed);
+}
+
+const char* getInstructionSetName(SimdInstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+        case SimdInstructionSet::generic: return "Generic";
+        case SimdInstructionSet::sse2:    return "SSE2";
+        case SimdInstructionSet::avx2:    return "AVX2";
+        case SimdInstructionSet::avx512:  return "AVX-512";
+    }
+
+    return "";
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+/*
+ The hot loops of the plugin, compiled once per instruction set and picked at
+ runtime from what the CPU supports.
+
+ This header is shared with translation units built with AVX2 or AVX-512
+ enabled, so it must stay free of JUCE and of any inline code: a function
+ defined here would be compiled once per instruction set and the linker
+ could hand the AVX-512 copy to a machine that can't run it. That includes
+ the constructors the compiler writes for a struct with default member
+ initialisers or a vtable, so structs here leave their members to the code
+ that fills them, and the engine interfaces construct out of line.
+ FilterDesign.h has inline code, so only FilterSections.h comes in here.
+ */
+
+#include "FilterSections.h"
+
+struct FilterCoefficientSet;
+
+enum class SimdInstructionSet
+{
+    generic,    // juce::dsp::SIMDRegister for the cascade, plain loops for the rest
+    sse2,
+    avx2,
+    avx512
+};
+
+constexpr int numInstructionSets = 4;
+
+constexpr int maxCascadeSections = 2 * maxCutSections + 1;
+
+/**
+ While coefficients ramp towards a new design, the cascades move them one step
+ every this many samples, whatever block size the host uses.
+ */
+constexpr int coefficientControlInterval = 32;
+
+/**
+ Sizes passed to the analyzer, response-curve and spectrum kernels must be a
+ multiple of this, so that no instruction set needs a scalar tail loop.
+ */
+constexpr int dspKernelPadding = 16;
+
+/**
+ A biquad's denominator at DC, 1 + a1 + a2, is the product of its two poles'
+ distances from z = 1, and 1 - a1 + a2 the same for z = -1. Below this, float
+ rounding of a1 and a2 (about 1e-7) moves the poles enough to hear: a low cut
+ near 20 Hz at 96 or 192 kHz has its corner shifted by tenths of a dB. The
+ state-variable form keeps its precision there, so float cascades run such
+ sections as SVFs and everything else as the cheaper biquad.
+ */
+constexpr double minBiquadPoleDistance = 1.0e-4;
+
+/** Whether a float biquad would misplace this section's poles; see minBiquadPoleDistance. */
+bool needsStateVariable(const BiquadCoefficients& coefficients);
+
+/**
+ The active sections of a FilterCoefficientSet in processing order, as plain
+ data the kernels can read without touching anything outside themselves.
+ Value-initialise one ({}) to start with no sections.
+ */
+struct CascadeSections
+{
+    struct Section
+    {
+        // Where the section sits in the full chain (low-cut 0-3, peak 4,
+        // high-cut 5-8), so its state can follow it when others switch in or out.
+        int slot;
+        SectionTopology topology;
+        BiquadCoefficients coefficients;
+        SvfCoefficients svf;
+    };
+
+    Section sections[maxCascadeSections];
+    int numSections;
+};
+
+/** Each section takes its band's topology from the set. */
+CascadeSections packCascadeSections(const FilterCoefficientSet& coefficients);
+
+/**
+ A biquad's squared magnitude as a function of cos(w) and cos(2w):
+ |H|^2 = (n0 + n1 cos w + n2 cos 2w) / (d0 + d1 cos w + d2 cos 2w).
+ */
+struct MagnitudeResponseSection
+{
+    double n0, n1, n2;
+    double d0, d1, d2;
+};
+
+MagnitudeResponseSection makeMagnitudeResponseSection(const BiquadCoefficients& coefficients);
+
+/**
+ Somewhere to run independent pieces of work at the same time, such as the
+ threads an offline render spreads its channels across.
+ */
+struct TaskRunner
+{
+    TaskRunner();
+    virtual ~TaskRunner();
+
+    /** Calls task(context, i) once for every i below numTasks, in any order and on any thread, and returns when all are done. */
+    virtual void run(int numTasks, void (*task)(void* context, int index), void* context) = 0;
+};
+
+/**
+ The multichannel biquad cascade behind FilterCascade, implemented once per
+ instruction set.
+ */
+template<typename SampleType>
+struct FilterCascadeEngine
+{
+    FilterCascadeEngine();
+    virtual ~FilterCascadeEngine();
+
+    virtual void prepare(int numChannels, int maximumBlockSize) = 0;
+    virtual void reset() = 0;
+    /**
+     Moves to new sections. Sections that stay active glide from their current
+     coefficients to the new ones over rampSamples (rounded up to whole control
+     intervals); sections switching in or out, or a ramp of 0, change at once.
+     */
+    virtual void setSections(const CascadeSections& sections, int rampSamples) = 0;
+    virtual void process(SampleType* const* channels, int numChannels, int numSamples) = 0;
+
+    /**
+     Lets process() hand each register's worth of channels to runner, or keeps
+     everything on the calling thread with nullptr. Every channel comes out
+     the same either way.
+     */
+    virtual void setTaskRunner(TaskRunner* runner) = 0;
+};
+
+extern template struct FilterCascadeEngine<float>;
+extern template struct FilterCascadeEngine<double>;
+
+/**
+ The half-band stages of the oversampler: base rate to 2x keeps everything up
+ to 0.23 of the 2x rate (20.3 kHz at 44.1) and rejects images by about 99 dB;
+ 2x to 4x only has to clear what the first stage let through, so half the
+ coefficients do the same there.
+ */
+constexpr int maxOversamplingFactor = 4;
+constexpr int firstHalfBandCoefficients = 8, secondHalfBandCoefficients = 4;
+constexpr double firstHalfBandTransition = 0.04, secondHalfBandTransition = 0.2;
+
+/** What oversampling by factor (1, 2 or 4) delays low frequencies by, in base-rate samples. */
+double getOversamplingLatency(int factor);
+
+/**
+ 2x or 4x up- and downsampling through polyphase IIR half-band filters for
+ every channel at once, implemented once per instruction set.
+ */
+template<typename SampleType>
+struct OversamplingEngine
+{
+    OversamplingEngine();
+    virtual ~OversamplingEngine();
+
+    /** Allocates for maxOversamplingFactor, so the factor can change from block to block. */
+    virtual void prepare(int numChannels, int maximumBlockSize) = 0;
+    virtual void reset() = 0;
+
+    /**
+     Upsamples by factor (2 or 4) into buffers of the engine's own and returns
+     them, numSamples * factor per channel. numSamples must not exceed the
+     prepared maximumBlockSize.
+     */
+    virtual SampleType* const* processUp(const SampleType* const* channels, int numChannels, int numSamples, int factor) = 0;
+
+    /** Filters those buffers back down into channels. */
+    virtual void processDown(SampleType* const* channels, int numChannels, int numSamples, int factor) = 0;
+
+    /** As for FilterCascadeEngine. */
+    virtual void setTaskRunner(TaskRunner* runner) = 0;
+};
+
+extern template struct OversamplingEngine<float>;
+extern template struct OversamplingEngine<double>;
+
+/**
+ Every kernel entry point for one instruction set.
+ */
+struct DspKernels
+{
+    SimdInstructionSet instructionSet;
+
+    /** How many float or double channels one register of this instruction set holds. */
+    int floatLanes, doubleLanes;
+
+    /** Channels interleaved across the lanes of a register. */
+    FilterCascadeEngine<float>* (*createFloatCascade)();
+    FilterCascadeEngine<double>* (*createDoubleCascade)();
+
+    /** One channel at a time, a register's worth of samples per step; see BlockStateSpaceEngine. */
+    FilterCascadeEngine<float>* (*createFloatBlockCascade)();
+    FilterCascadeEngine<double>* (*createDoubleBlockCascade)();
+
+    /** Channels interleaved across the lanes of a register, like the cascade. */
+    OversamplingEngine<float>* (*createFloatOversampler)();
+    OversamplingEngine<double>* (*createDoubleOversampler)();
+
+    /** data[i] *= window[i]. */
+    void (*applyWindow)(float* data, const float* window, int numSamples);
+
+    /** data[i] = max(minusInfinityDb, 20 log10(data[i] * scale)), with non-finite values treated as silence. */
+    void (*magnitudesToDecibels)(float* data, int numBins, float scale, float minusInfinityDb);
+
+    /** result[i] = product over sections of |H|^2 at the frequency whose cos(w) and cos(2w) are given. */
+    void (*evaluateMagnitudeSquared)(const MagnitudeResponseSection* sections, int numSections,
+                                     const double* cosW, const double* cos2W, double* result, int numPoints);
+
+    /** acc[i] += x[i] * h[i] for complex spectra held as separate real and imaginary arrays. */
+    void (*multiplyAccumulateSpectra)(float* accReal, float* accImag,
+                                      const float* xReal, const float* xImag,
+                                      const float* hReal, const float* hImag, int numBins);
+
+    /** The largest |data[i]|. Any length: unlike the others, this runs on the host's unpadded buffers. */
+    float (*findFloatPeakMagnitude)(const float* data, int numSamples);
+    double (*findDoublePeakMagnitude)(const double* data, int numSamples);
+
+    /**
+     destination[i] = from[i] + (to[i] - from[i]) * (i + 1) / numSamples, so the last
+     sample is all to. Any length, and destination may be either input.
+     */
+    void (*crossfadeFloats)(const float* from, const float* to, float* destination, int numSamples);
+    void (*crossfadeDoubles)(const double* from, const double* to, double* destination, int numSamples);
+};
+
+/** The instruction sets compiled into this build that the CPU can run, narrowest first; result needs room for numInstructionSets. */
+int getAvailableInstructionSets(SimdInstructionSet* result);
+
+/** The kernels for one instruction set, or nullptr if it isn't built in or the CPU can't run it. */
+const DspKernels* getDspKernels(SimdInstructionSet instructionSet);
+
+/** The widest kernels this CPU can run, or the forced ones. */
+const DspKernels& getDspKernels();
+
+/**
+ The kernels a cascade of numChannels should use: the narrowest instruction set
+ whose registers hold every channel, at single or double precision, or the
+ widest there is. Honours a forced instruction set.
+ */
+const DspKernels& getDspKernelsForChannels(int numChannels, bool doublePrecision = false);
+
+/**
+ Makes every later kernel lookup return this instruction set, so a benchmark can
+ time each path. Cascades pick it up when they are next prepared. Returns false
+ (and changes nothing) if the set isn't available here.
+ */
+bool forceInstructionSet(SimdInstructionSet instructionSet);
+
+/** Goes back to choosing from the CPU. */
+void clearForcedInstructionSet();
+
+const char* getInstructionSetName(SimdInstructionSet instructionSet);
+
+// Defined by each per-instruction-set translation unit; nullptr when that
+// instruction set isn't compiled into this build.
+const DspKernels* getGenericDspKernels();
+const DspKernels* getSse2DspKernels();
+const DspKernels* getAvx2DspKernels();
+const DspKernels* getAvx512DspKernels();
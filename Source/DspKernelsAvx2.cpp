@@ -0,0 +1,88 @@
+/*
+ Built with AVX2 and FMA enabled (see CMakeLists.txt) and only ever called
+ after the CPU has been checked, so everything compiled here must stay in
+ the namespace below; see DspKernels.h.
+ */
+#include "DspKernels.h"
+
+#if defined(__AVX2__)
+
+#include <utility>
+
+#include <immintrin.h>
+
+namespace avx2Kernels
+{
+    struct FloatVec
+    {
+        using ElementType = float;
+        static constexpr size_t SIMDNumElements = 8;
+
+        __m256 value;
+
+        static FloatVec expand(float s) { return { _mm256_set1_ps(s) }; }
+        static FloatVec fromRawArray(const float* a) { return { _mm256_load_ps(a) }; }
+        void copyToRawArray(float* a) const { _mm256_store_ps(a, value); }
+        static FloatVec loadUnaligned(const float* a) { return { _mm256_loadu_ps(a) }; }
+        void storeUnaligned(float* a) const { _mm256_storeu_ps(a, value); }
+
+        friend FloatVec operator+(FloatVec a, FloatVec b) { return { _mm256_add_ps(a.value, b.value) }; }
+        friend FloatVec operator-(FloatVec a, FloatVec b) { return { _mm256_sub_ps(a.value, b.value) }; }
+        friend FloatVec operator*(FloatVec a, FloatVec b) { return { _mm256_mul_ps(a.value, b.value) }; }
+        friend FloatVec operator/(FloatVec a, FloatVec b) { return { _mm256_div_ps(a.value, b.value) }; }
+
+        static FloatVec max(FloatVec a, FloatVec b) { return { _mm256_max_ps(a.value, b.value) }; }
+
+        static FloatVec finitePositiveOrZero(FloatVec v)
+        {
+            const auto infinity = _mm256_castsi256_ps(_mm256_set1_epi32(0x7f800000));
+            const auto keep = _mm256_and_ps(_mm256_cmp_ps(v.value, _mm256_setzero_ps(), _CMP_GT_OQ),
+                                            _mm256_cmp_ps(v.value, infinity, _CMP_LT_OQ));
+            return { _mm256_and_ps(keep, v.value) };
+        }
+
+        static void splitExponent(FloatVec v, FloatVec& exponent, FloatVec& mantissa)
+        {
+            const auto bits = _mm256_castps_si256(v.value);
+            const auto biased = _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff));
+            exponent.value = _mm256_cvtepi32_ps(_mm256_sub_epi32(biased, _mm256_set1_epi32(127)));
+            mantissa.value = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                                                 _mm256_set1_epi32(0x3f800000)));
+        }
+    };
+
+    struct DoubleVec
+    {
+        using ElementType = double;
+        static constexpr size_t SIMDNumElements = 4;
+
+        __m256d value;
+
+        static DoubleVec expand(double s) { return { _mm256_set1_pd(s) }; }
+        static DoubleVec fromRawArray(const double* a) { return { _mm256_load_pd(a) }; }
+        void copyToRawArray(double* a) const { _mm256_store_pd(a, value); }
+        static DoubleVec loadUnaligned(const double* a) { return { _mm256_loadu_pd(a) }; }
+        void storeUnaligned(double* a) const { _mm256_storeu_pd(a, value); }
+
+        friend DoubleVec operator+(DoubleVec a, DoubleVec b) { return { _mm256_add_pd(a.value, b.value) }; }
+        friend DoubleVec operator-(DoubleVec a, DoubleVec b) { return { _mm256_sub_pd(a.value, b.value) }; }
+        friend DoubleVec operator*(DoubleVec a, DoubleVec b) { return { _mm256_mul_pd(a.value, b.value) }; }
+        friend DoubleVec operator/(DoubleVec a, DoubleVec b) { return { _mm256_div_pd(a.value, b.value) }; }
+
+        static DoubleVec max(DoubleVec a, DoubleVec b) { return { _mm256_max_pd(a.value, b.value) }; }
+    };
+
+    #include "DspKernelsImpl.h"
+}
+
+const DspKernels* getAvx2DspKernels()
+{
+    static const DspKernels kernels = avx2Kernels::makeDspKernels<avx2Kernels::FloatVec, avx2Kernels::DoubleVec>(SimdInstructionSet::avx2);
+    return &kernels;
+}
+
+#else
+
+const DspKernels* getAvx2DspKernels() { return nullptr; }
+
+#endif
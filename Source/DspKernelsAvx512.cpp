@@ -0,0 +1,88 @@
+/*
+ Built with AVX-512F enabled (see CMakeLists.txt) and only ever called
+ after the CPU has been checked, so everything compiled here must stay in
+ the namespace below; see DspKernels.h.
+ */
+#include "DspKernels.h"
+
+#if defined(__AVX512F__)
+
+#include <utility>
+
+#include <immintrin.h>
+
+namespace avx512Kernels
+{
+    struct FloatVec
+    {
+        using ElementType = float;
+        static constexpr size_t SIMDNumElements = 16;
+
+        __m512 value;
+
+        static FloatVec expand(float s) { return { _mm512_set1_ps(s) }; }
+        static FloatVec fromRawArray(const float* a) { return { _mm512_load_ps(a) }; }
+        void copyToRawArray(float* a) const { _mm512_store_ps(a, value); }
+        static FloatVec loadUnaligned(const float* a) { return { _mm512_loadu_ps(a) }; }
+        void storeUnaligned(float* a) const { _mm512_storeu_ps(a, value); }
+
+        friend FloatVec operator+(FloatVec a, FloatVec b) { return { _mm512_add_ps(a.value, b.value) }; }
+        friend FloatVec operator-(FloatVec a, FloatVec b) { return { _mm512_sub_ps(a.value, b.value) }; }
+        friend FloatVec operator*(FloatVec a, FloatVec b) { return { _mm512_mul_ps(a.value, b.value) }; }
+        friend FloatVec operator/(FloatVec a, FloatVec b) { return { _mm512_div_ps(a.value, b.value) }; }
+
+        static FloatVec max(FloatVec a, FloatVec b) { return { _mm512_max_ps(a.value, b.value) }; }
+
+        static FloatVec finitePositiveOrZero(FloatVec v)
+        {
+            const auto infinity = _mm512_castsi512_ps(_mm512_set1_epi32(0x7f800000));
+            const auto keep = _mm512_cmp_ps_mask(v.value, _mm512_setzero_ps(), _CMP_GT_OQ)
+                            & _mm512_cmp_ps_mask(v.value, infinity, _CMP_LT_OQ);
+            return { _mm512_maskz_mov_ps((__mmask16)keep, v.value) };
+        }
+
+        static void splitExponent(FloatVec v, FloatVec& exponent, FloatVec& mantissa)
+        {
+            const auto bits = _mm512_castps_si512(v.value);
+            const auto biased = _mm512_and_si512(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0xff));
+            exponent.value = _mm512_cvtepi32_ps(_mm512_sub_epi32(biased, _mm512_set1_epi32(127)));
+            mantissa.value = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+                                                                 _mm512_set1_epi32(0x3f800000)));
+        }
+    };
+
+    struct DoubleVec
+    {
+        using ElementType = double;
+        static constexpr size_t SIMDNumElements = 8;
+
+        __m512d value;
+
+        static DoubleVec expand(double s) { return { _mm512_set1_pd(s) }; }
+        static DoubleVec fromRawArray(const double* a) { return { _mm512_load_pd(a) }; }
+        void copyToRawArray(double* a) const { _mm512_store_pd(a, value); }
+        static DoubleVec loadUnaligned(const double* a) { return { _mm512_loadu_pd(a) }; }
+        void storeUnaligned(double* a) const { _mm512_storeu_pd(a, value); }
+
+        friend DoubleVec operator+(DoubleVec a, DoubleVec b) { return { _mm512_add_pd(a.value, b.value) }; }
+        friend DoubleVec operator-(DoubleVec a, DoubleVec b) { return { _mm512_sub_pd(a.value, b.value) }; }
+        friend DoubleVec operator*(DoubleVec a, DoubleVec b) { return { _mm512_mul_pd(a.value, b.value) }; }
+        friend DoubleVec operator/(DoubleVec a, DoubleVec b) { return { _mm512_div_pd(a.value, b.value) }; }
+
+        static DoubleVec max(DoubleVec a, DoubleVec b) { return { _mm512_max_pd(a.value, b.value) }; }
+    };
+
+    #include "DspKernelsImpl.h"
+}
+
+const DspKernels* getAvx512DspKernels()
+{
+    static const DspKernels kernels = avx512Kernels::makeDspKernels<avx512Kernels::FloatVec, avx512Kernels::DoubleVec>(SimdInstructionSet::avx512);
+    return &kernels;
+}
+
+#else
+
+const DspKernels* getAvx512DspKernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,83 @@
+#include <juce_dsp/juce_dsp.h>
+
+#include "DspKernels.h"
+
+#include <cmath>
+#include <utility>
+
+/*
+ The fallback for CPUs without one of the x86 builds, e.g. NEON on ARM: the
+ cascade runs on juce::dsp::SIMDRegister, and the analyzer, response-curve
+ and spectrum kernels run a lane at a time.
+ */
+namespace genericKernels
+{
+    template<typename Type>
+    struct ScalarVec
+    {
+        using ElementType = Type;
+        static constexpr size_t SIMDNumElements = 1;
+
+        Type value;
+
+        static ScalarVec expand(Type s) { return { s }; }
+        static ScalarVec loadUnaligned(const Type* a) { return { *a }; }
+        void storeUnaligned(Type* a) const { *a = value; }
+
+        friend ScalarVec operator+(ScalarVec a, ScalarVec b) { return { a.value + b.value }; }
+        friend ScalarVec operator-(ScalarVec a, ScalarVec b) { return { a.value - b.value }; }
+        friend ScalarVec operator*(ScalarVec a, ScalarVec b) { return { a.value * b.value }; }
+        friend ScalarVec operator/(ScalarVec a, ScalarVec b) { return { a.value / b.value }; }
+
+        static ScalarVec max(ScalarVec a, ScalarVec b) { return { juce::jmax(a.value, b.value) }; }
+
+        static ScalarVec finitePositiveOrZero(ScalarVec v)
+        {
+            return { v.value > 0 && std::isfinite(v.value) ? v.value : Type(0) };
+        }
+
+        static void splitExponent(ScalarVec v, ScalarVec& exponent, ScalarVec& mantissa)
+        {
+            if (v.value <= 0)
+            {
+                exponent.value = -127;
+                mantissa.value = 1;
+                return;
+            }
+
+            int e = 0;
+            mantissa.value = std::frexp(v.value, &e) * 2;
+            exponent.value = (Type)(e - 1);
+        }
+    };
+
+    #include "DspKernelsImpl.h"
+}
+
+const DspKernels* getGenericDspKernels()
+{
+    using namespace genericKernels;
+
+    static const DspKernels kernels
+    {
+        SimdInstructionSet::generic,
+        (int)juce::dsp::SIMDRegister<float>::SIMDNumElements,
+        (int)juce::dsp::SIMDRegister<double>::SIMDNumElements,
+        &createCascadeEngine<juce::dsp::SIMDRegister<float>>,
+        &createCascadeEngine<juce::dsp::SIMDRegister<double>>,
+        &createBlockStateSpaceEngine<juce::dsp::SIMDRegister<float>>,
+        &createBlockStateSpaceEngine<juce::dsp::SIMDRegister<double>>,
+        &createOversampler<juce::dsp::SIMDRegister<float>>,
+        &createOversampler<juce::dsp::SIMDRegister<double>>,
+        &applyWindow<ScalarVec<float>>,
+        &magnitudesToDecibels<ScalarVec<float>>,
+        &evaluateMagnitudeSquared<ScalarVec<double>>,
+        &multiplyAccumulateSpectra<ScalarVec<float>>,
+        &findPeakMagnitude<ScalarVec<float>>,
+        &findPeakMagnitude<ScalarVec<double>>,
+        &crossfade<ScalarVec<float>>,
+        &crossfade<ScalarVec<double>>
+    };
+
+    return &kernels;
+}
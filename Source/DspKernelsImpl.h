@@ -0,0 +1,1439 @@
+/*
+ The kernels behind DspKernels, written once against a register type.
+
+ Each per-instruction-set translation unit includes everything this needs
+ (DspKernels.h and <utility>, for std::integer_sequence), opens its own
+ namespace, defines FloatVec and DoubleVec for its registers and then
+ includes this file. Nothing in here is shared between instruction sets, so
+ keep it that way: no #includes, no calls to inline functions from outside
+ the namespace, and no standard library templates instantiated on types
+ from outside it either. std::unique_ptr<float[]> would be the same
+ function in every translation unit, so arrays are owned by HeapArray below.
+
+ The cascade needs the juce::dsp::SIMDRegister interface (ElementType,
+ SIMDNumElements, expand, fromRawArray, copyToRawArray, + - *), so it can run
+ on SIMDRegister itself. The analyzer, response-curve and spectrum kernels
+ also need loadUnaligned, storeUnaligned, /, max, finitePositiveOrZero and
+ splitExponent.
+ */
+
+/**
+ An array on the heap that frees itself, for what std::unique_ptr<T[]> would
+ otherwise do; see above.
+ */
+template<typename T>
+struct HeapArray
+{
+    HeapArray() = default;
+    ~HeapArray() { delete[] elements; }
+
+    HeapArray(const HeapArray&) = delete;
+    HeapArray& operator=(const HeapArray&) = delete;
+
+    void allocate(size_t size)
+    {
+        delete[] elements;
+        elements = new T[size];
+    }
+
+    T* get() const { return elements; }
+    T& operator[](size_t index) const { return elements[index]; }
+private:
+    T* elements = nullptr;
+};
+
+/**
+ Linear ramps from each section's current coefficients to its newly designed
+ ones, one step per coefficientControlInterval samples. The engines keep that
+ grid running between ramps, so a new ramp holds where it starts until the
+ next boundary instead of restarting the grid wherever a design happens to
+ land. Every point on the way
+ is a mix of two stable biquads, and so stable itself: the region of (a1, a2)
+ that keeps a biquad stable is a triangle, and a triangle is convex. The
+ state-variable form ramps alongside, and stays stable for the simpler reason
+ that g and k stay positive.
+ */
+struct CoefficientRamp
+{
+    BiquadCoefficients from[maxCascadeSections], to[maxCascadeSections];
+    SvfCoefficients svfFrom[maxCascadeSections], svfTo[maxCascadeSections];
+    int step = 0, numSteps = 0;
+
+    /** previousSlots and previousNumSections describe the sections the ramp was running until now. */
+    void start(const CascadeSections& packed, const int* previousSlots, int previousNumSections, int rampSamples)
+    {
+        BiquadCoefficients current[maxCascadeSections];
+        SvfCoefficients currentSvf[maxCascadeSections];
+
+        for (int j = 0; j < previousNumSections; ++j)
+        {
+            current[j] = getCoefficients(j);
+            currentSvf[j] = getStateVariable(j);
+        }
+
+        for (int i = 0; i < packed.numSections; ++i)
+        {
+            to[i] = packed.sections[i].coefficients;
+            svfTo[i] = packed.sections[i].svf;
+
+            // A section that wasn't running starts out with its own poles but
+            // a numerator that cancels them, which its empty state is already
+            // consistent with, and ramps in from there: for the SVF that is
+            // exactly a crossfade from the dry signal.
+            from[i] = { 1.0, to[i].a1, to[i].a2, to[i].a1, to[i].a2 };
+            svfFrom[i] = { svfTo[i].g, svfTo[i].k, 1.0, 0.0, 0.0 };
+
+            for (int j = 0; j < previousNumSections; ++j)
+            {
+                if (previousSlots[j] == packed.sections[i].slot)
+                {
+                    from[i] = current[j];
+                    svfFrom[i] = currentSvf[j];
+                }
+            }
+        }
+
+        numSteps = rampSamples > 0 ? (rampSamples + coefficientControlInterval - 1) / coefficientControlInterval : 0;
+        step = 0;
+    }
+
+    bool isRamping() const { return step < numSteps; }
+
+    /** How far the next grid boundary is after numSamples more, given it was untilStep away. */
+    static int advanceGrid(int untilStep, int numSamples)
+    {
+        if (numSamples < untilStep)
+            return untilStep - numSamples;
+
+        return coefficientControlInterval - (numSamples - untilStep) % coefficientControlInterval;
+    }
+
+    void advance()
+    {
+        if (step < numSteps)
+            ++step;
+    }
+
+    BiquadCoefficients getCoefficients(int section) const { return getCoefficients(section, step); }
+    SvfCoefficients getStateVariable(int section) const { return getStateVariable(section, step); }
+
+    /** Where the ramp is at atStep, for engines that step their channels through it one group at a time. */
+    BiquadCoefficients getCoefficients(int section, int atStep) const
+    {
+        if (atStep >= numSteps)
+            return to[section];
+
+        const auto t = (double)atStep / (double)numSteps;
+        const auto& a = from[section];
+        const auto& b = to[section];
+
+        return { a.b0 + (b.b0 - a.b0) * t,
+                 a.b1 + (b.b1 - a.b1) * t,
+                 a.b2 + (b.b2 - a.b2) * t,
+                 a.a1 + (b.a1 - a.a1) * t,
+                 a.a2 + (b.a2 - a.a2) * t };
+    }
+
+    SvfCoefficients getStateVariable(int section, int atStep) const
+    {
+        if (atStep >= numSteps)
+            return svfTo[section];
+
+        const auto t = (double)atStep / (double)numSteps;
+        const auto& a = svfFrom[section];
+        const auto& b = svfTo[section];
+
+        return { a.g + (b.g - a.g) * t,
+                 a.k + (b.k - a.k) * t,
+                 a.m0 + (b.m0 - a.m0) * t,
+                 a.m1 + (b.m1 - a.m1) * t,
+                 a.m2 + (b.m2 - a.m2) * t };
+    }
+};
+
+/**
+ The sections with the SVFs first, which is the order the engines keep them
+ in, and how many SVFs there are. FilterCascade only ever asks for SVFs at the
+ front of the chain, so while topologies are mixed no section moves past
+ another: the state of a cascade depends on its order.
+ */
+int orderByTopology(const CascadeSections& packed, CascadeSections& ordered)
+{
+    const SectionTopology order[] { SectionTopology::stateVariable, SectionTopology::biquad };
+
+    ordered.numSections = 0;
+
+    for (auto topology : order)
+        for (int i = 0; i < packed.numSections; ++i)
+            if (packed.sections[i].topology == topology)
+                ordered.sections[ordered.numSections++] = packed.sections[i];
+
+    int numSvfs = 0;
+
+    while (numSvfs < ordered.numSections && ordered.sections[numSvfs].topology == SectionTopology::stateVariable)
+        ++numSvfs;
+
+    return numSvfs;
+}
+
+/**
+ Takes a section's two state values from one topology to the other, for the
+ coefficients it is running with, so that a section changing topology carries
+ on without a click. Both forms realise the same second-order response, so
+ their outputs with no input from any state follow the same two-term
+ recurrence, and matching the first two of those samples matches them all.
+ */
+struct StateConversion
+{
+    double m11 = 0.0, m12 = 0.0, m21 = 0.0, m22 = 0.0;
+
+    static StateConversion make(const BiquadCoefficients& biquad, const SvfCoefficients& svf, bool toStateVariable)
+    {
+        // The first two output samples with no input, per unit of each state
+        // value. Transposed direct form II gives s1, then s2 - a1 s1.
+        const double direct[2][2] { { 1.0, 0.0 }, { -biquad.a1, 1.0 } };
+
+        // The SVF outputs c1 ic1 + c2 ic2, then the same of its next state.
+        const auto g1 = 1.0 / (1.0 + svf.g * (svf.g + svf.k)), g2 = svf.g * g1, g3 = svf.g * g2;
+        const auto c1 = svf.m1 * g1 + svf.m2 * g2, c2 = svf.m2 * (1.0 - g3) - svf.m1 * g2;
+        const double stateVariable[2][2] { { c1, c2 },
+                                           { c1 * (2.0 * g1 - 1.0) + c2 * 2.0 * g2, c2 * (1.0 - 2.0 * g3) - c1 * 2.0 * g2 } };
+
+        const auto& from = toStateVariable ? direct : stateVariable;
+        const auto& to = toStateVariable ? stateVariable : direct;
+
+        // A unity SVF's output doesn't depend on its state, and there is
+        // nothing to carry over.
+        const auto determinant = to[0][0] * to[1][1] - to[0][1] * to[1][0];
+        StateConversion conversion;
+
+        if (determinant > -1.0e-30 && determinant < 1.0e-30)
+            return conversion;
+
+        conversion.m11 = (to[1][1] * from[0][0] - to[0][1] * from[1][0]) / determinant;
+        conversion.m12 = (to[1][1] * from[0][1] - to[0][1] * from[1][1]) / determinant;
+        conversion.m21 = (to[0][0] * from[1][0] - to[1][0] * from[0][0]) / determinant;
+        conversion.m22 = (to[0][0] * from[1][1] - to[1][0] * from[0][1]) / determinant;
+        return conversion;
+    }
+};
+
+/**
+ For each section of an engine's new layout, where it was running until now
+ (or -1 if it is new), and the conversion its state needs if its topology
+ changed. The ramp must still be at the point the old layout reached.
+ */
+void findPreviousSections(const CascadeSections& packed, int numSvfs,
+                          const int* previousSlots, int previousNumSections, int previousNumSvfs,
+                          const CoefficientRamp& ramp, int* sources, StateConversion* conversions)
+{
+    for (int i = 0; i < packed.numSections; ++i)
+    {
+        sources[i] = -1;
+
+        for (int j = 0; j < previousNumSections; ++j)
+        {
+            if (previousSlots[j] != packed.sections[i].slot)
+                continue;
+
+            sources[i] = j;
+
+            if ((j < previousNumSvfs) != (i < numSvfs))
+                conversions[i] = StateConversion::make(ramp.getCoefficients(j), ramp.getStateVariable(j), i < numSvfs);
+        }
+    }
+}
+
+/**
+ The whole EQ as one cascade of biquads that filters every channel at once.
+
+ Channels are interleaved into the lanes of a register, so each step of the
+ cascade runs the same section on SIMDNumElements channels in a single
+ instruction; channels beyond the register width go into another group of
+ lanes.
+
+ The active sections of a group sit packed together in one flat arena,
+ coefficients next to their state. A kernel specialised for that exact number
+ of sections pulls them all into registers and runs every section on each
+ sample before moving to the next, so the whole cascade is a single pass over
+ the block and bypassed sections or shallower slopes cost nothing. While
+ coefficients ramp, the pass stops every control interval to move them.
+
+ Sections run either as biquads or as TPT state-variable filters. The SVFs
+ go first and the biquads after them; the cascade is linear and
+ time-invariant between updates, so the order doesn't change the response.
+ */
+template<typename Vec>
+class CascadeEngine final : public FilterCascadeEngine<typename Vec::ElementType>
+{
+public:
+    using SampleType = typename Vec::ElementType;
+
+    static constexpr int numLanes = (int)Vec::SIMDNumElements;
+
+    void prepare(int numChannels, int maximumBlockSize) override
+    {
+        preparedChannels = numChannels;
+        blockSize = maximumBlockSize > 1 ? maximumBlockSize : 1;
+        numGroups = (numChannels + numLanes - 1) / numLanes;
+
+        frames.allocate((size_t)(numGroups * blockSize));
+        arena.allocate((size_t)(numGroups * maxCascadeSections));
+        numActiveSections = 0;
+
+        reset();
+    }
+
+    void reset() override
+    {
+        for (int i = 0; i < numGroups * maxCascadeSections; ++i)
+            arena[(size_t)i].s1 = arena[(size_t)i].s2 = Vec::expand(0);
+    }
+
+    void setSections(const CascadeSections& unordered, int rampSamples) override
+    {
+        CascadeSections packed;
+        const auto newNumSvfs = orderByTopology(unordered, packed);
+
+        bool layoutChanged = packed.numSections != numActiveSections || newNumSvfs != numSvfs;
+
+        for (int i = 0; i < packed.numSections && !layoutChanged; ++i)
+            layoutChanged = packed.sections[i].slot != activeSlots[i];
+
+        // Sections that stay active take their state with them to their new
+        // packed position; ones that were switched off are dropped, and newly
+        // enabled ones start from silence and ramp in from unity gain. A
+        // section that changes topology has its state converted on the way.
+        if (layoutChanged)
+        {
+            int sources[maxCascadeSections];
+            StateConversion conversions[maxCascadeSections];
+            findPreviousSections(packed, newNumSvfs, activeSlots, numActiveSections, numSvfs, ramp, sources, conversions);
+
+            for (int group = 0; group < numGroups; ++group)
+            {
+                auto* sections = getGroupSections(group);
+                Section previous[maxCascadeSections];
+
+                for (int j = 0; j < numActiveSections; ++j)
+                    previous[j] = sections[j];
+
+                for (int i = 0; i < packed.numSections; ++i)
+                {
+                    const auto j = sources[i];
+                    sections[i].s1 = sections[i].s2 = Vec::expand(0);
+
+                    if (j < 0)
+                        continue;
+
+                    if ((j < numSvfs) == (i < newNumSvfs))
+                    {
+                        sections[i].s1 = previous[j].s1;
+                        sections[i].s2 = previous[j].s2;
+                    }
+                    else
+                    {
+                        const auto& m = conversions[i];
+                        sections[i].s1 = Vec::expand((SampleType)m.m11) * previous[j].s1 + Vec::expand((SampleType)m.m12) * previous[j].s2;
+                        sections[i].s2 = Vec::expand((SampleType)m.m21) * previous[j].s1 + Vec::expand((SampleType)m.m22) * previous[j].s2;
+                    }
+                }
+            }
+        }
+
+        ramp.start(packed, activeSlots, numActiveSections, rampSamples);
+
+        for (int i = 0; i < packed.numSections; ++i)
+            activeSlots[i] = packed.sections[i].slot;
+
+        numActiveSections = packed.numSections;
+        numSvfs = newNumSvfs;
+        writeCoefficients();
+    }
+
+    void process(SampleType* const* channels, int numChannels, int numSamples) override
+    {
+        if (numChannels > preparedChannels)
+            numChannels = preparedChannels;
+
+        const auto numUsedGroups = (numChannels + numLanes - 1) / numLanes;
+        const auto startStep = ramp.step;
+        GroupCall call { this, channels, numChannels, numSamples };
+
+        if (taskRunner != nullptr && numUsedGroups > 1)
+            taskRunner->run(numUsedGroups, &processGroupTask, &call);
+        else
+            for (int group = 0; group < numUsedGroups; ++group)
+                processGroup(group, channels, numChannels, numSamples);
+
+        // Each group stepped through the ramp on its own; move on to where they got.
+        int done = 0;
+
+        while (done < numSamples && ramp.isRamping())
+        {
+            const auto segment = numSamples - done < samplesUntilStep ? numSamples - done : samplesUntilStep;
+            done += segment;
+
+            if ((samplesUntilStep -= segment) == 0)
+            {
+                ramp.advance();
+                samplesUntilStep = coefficientControlInterval;
+            }
+        }
+
+        samplesUntilStep = CoefficientRamp::advanceGrid(samplesUntilStep, numSamples - done);
+
+        if (ramp.step != startStep)
+            for (int group = numUsedGroups; group < numGroups; ++group)
+                writeGroupCoefficients(group, ramp.step);
+    }
+
+    void setTaskRunner(TaskRunner* runner) override { taskRunner = runner; }
+private:
+    struct Section
+    {
+        // Biquad.
+        Vec b0, b1, b2, a1, a2;
+
+        // State-variable filter: Simper's a1, a2 and a3 from g and k, then the output mix.
+        Vec g1, g2, g3, m0, m1, m2;
+
+        // The two state values of either.
+        Vec s1, s2;
+    };
+
+    using Kernel = void (*)(Section*, Vec*, int);
+    struct KernelRow { Kernel kernels[maxCascadeSections + 1]; };
+    struct KernelTable { KernelRow rows[maxCascadeSections + 1]; };
+
+    int preparedChannels = 0;
+    int blockSize = 0;
+    int numGroups = 0;
+
+    // maxCascadeSections per group, of which the first numActiveSections are live.
+    HeapArray<Section> arena;
+    int activeSlots[maxCascadeSections]{};
+    int numActiveSections = 0;
+    int numSvfs = 0;
+
+    CoefficientRamp ramp;
+    int samplesUntilStep = coefficientControlInterval;
+
+    // blockSize frames per group.
+    HeapArray<Vec> frames;
+
+    TaskRunner* taskRunner = nullptr;
+
+    struct GroupCall
+    {
+        CascadeEngine* engine;
+        SampleType* const* channels;
+        int numChannels, numSamples;
+    };
+
+    Section* getGroupSections(int group) { return arena.get() + group * maxCascadeSections; }
+    Vec* getGroupFrames(int group) const { return frames.get() + group * blockSize; }
+
+    static void processGroupTask(void* context, int group)
+    {
+        const auto& call = *static_cast<const GroupCall*>(context);
+        call.engine->processGroup(group, call.channels, call.numChannels, call.numSamples);
+    }
+
+    // Groups share nothing but the ramp, which each reads at its own position,
+    // so they can run on different threads.
+    void processGroup(int group, SampleType* const* channels, int numChannels, int numSamples)
+    {
+        const auto kernel = kernels.rows[numActiveSections - numSvfs].kernels[numSvfs];
+        auto* sections = getGroupSections(group);
+        auto* groupFrames = getGroupFrames(group);
+        auto step = ramp.step;
+        auto untilStep = samplesUntilStep;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            const auto num = numSamples - start < blockSize ? numSamples - start : blockSize;
+
+            interleave(group, channels, numChannels, start, num);
+
+            for (int done = 0; done < num;)
+            {
+                const auto ramping = step < ramp.numSteps;
+                auto segment = num - done;
+
+                if (ramping && segment > untilStep)
+                    segment = untilStep;
+
+                kernel(sections, groupFrames + done, segment);
+                done += segment;
+
+                if (ramping && (untilStep -= segment) == 0)
+                {
+                    writeGroupCoefficients(group, ++step);
+                    untilStep = coefficientControlInterval;
+                }
+            }
+
+            deinterleave(group, channels, numChannels, start, num);
+        }
+    }
+
+    void writeCoefficients()
+    {
+        for (int group = 0; group < numGroups; ++group)
+            writeGroupCoefficients(group, ramp.step);
+    }
+
+    void writeGroupCoefficients(int group, int atStep)
+    {
+        auto* sections = getGroupSections(group);
+
+        for (int i = numSvfs; i < numActiveSections; ++i)
+        {
+            const auto c = ramp.getCoefficients(i, atStep);
+            auto& section = sections[i];
+            section.b0 = Vec::expand((SampleType)c.b0); section.b1 = Vec::expand((SampleType)c.b1); section.b2 = Vec::expand((SampleType)c.b2);
+            section.a1 = Vec::expand((SampleType)c.a1); section.a2 = Vec::expand((SampleType)c.a2);
+        }
+
+        for (int i = 0; i < numSvfs; ++i)
+        {
+            const auto c = ramp.getStateVariable(i, atStep);
+            const auto a1 = 1.0 / (1.0 + c.g * (c.g + c.k));
+            auto& section = sections[i];
+            section.g1 = Vec::expand((SampleType)a1); section.g2 = Vec::expand((SampleType)(c.g * a1)); section.g3 = Vec::expand((SampleType)(c.g * c.g * a1));
+            section.m0 = Vec::expand((SampleType)c.m0); section.m1 = Vec::expand((SampleType)c.m1); section.m2 = Vec::expand((SampleType)c.m2);
+        }
+    }
+
+    template<typename Function, int... Indices>
+    static void unroll(std::integer_sequence<int, Indices...>, Function&& f)
+    {
+        (f(Indices), ...);
+    }
+
+    // Simper's trapezoidal SVF, then transposed direct form II, the same
+    // structure as juce::dsp::IIR::Filter, with every section's coefficients
+    // and state held in registers.
+    template<int NumBiquads, int NumSvfs>
+    static void processSections(Section* sections, Vec* data, int num)
+    {
+        if constexpr (NumBiquads + NumSvfs > 0)
+        {
+            constexpr auto biquads = std::make_integer_sequence<int, NumBiquads>();
+            constexpr auto svfs = std::make_integer_sequence<int, NumSvfs>();
+            constexpr size_t numBiquadArrays = NumBiquads > 0 ? (size_t)NumBiquads : 1;
+            constexpr size_t numSvfArrays = NumSvfs > 0 ? (size_t)NumSvfs : 1;
+
+            Vec b0[numBiquadArrays], b1[numBiquadArrays], b2[numBiquadArrays], a1[numBiquadArrays], a2[numBiquadArrays];
+            Vec s1[numBiquadArrays], s2[numBiquadArrays];
+
+            Vec g1[numSvfArrays], g2[numSvfArrays], g3[numSvfArrays], m0[numSvfArrays], m1[numSvfArrays], m2[numSvfArrays];
+            Vec ic1[numSvfArrays], ic2[numSvfArrays];
+
+            auto* svfSections = sections;
+            auto* biquadSections = sections + NumSvfs;
+
+            unroll(biquads, [&](int k)
+            {
+                b0[k] = biquadSections[k].b0; b1[k] = biquadSections[k].b1; b2[k] = biquadSections[k].b2;
+                a1[k] = biquadSections[k].a1; a2[k] = biquadSections[k].a2;
+                s1[k] = biquadSections[k].s1; s2[k] = biquadSections[k].s2;
+            });
+
+            unroll(svfs, [&](int k)
+            {
+                g1[k] = svfSections[k].g1; g2[k] = svfSections[k].g2; g3[k] = svfSections[k].g3;
+                m0[k] = svfSections[k].m0; m1[k] = svfSections[k].m1; m2[k] = svfSections[k].m2;
+                ic1[k] = svfSections[k].s1; ic2[k] = svfSections[k].s2;
+            });
+
+            for (int i = 0; i < num; ++i)
+            {
+                auto x = data[i];
+
+                unroll(svfs, [&](int k)
+                {
+                    const auto v3 = x - ic2[k];
+                    const auto v1 = g1[k] * ic1[k] + g2[k] * v3;
+                    const auto v2 = ic2[k] + g2[k] * ic1[k] + g3[k] * v3;
+                    ic1[k] = v1 + v1 - ic1[k];
+                    ic2[k] = v2 + v2 - ic2[k];
+                    x = m0[k] * x + m1[k] * v1 + m2[k] * v2;
+                });
+
+                unroll(biquads, [&](int k)
+                {
+                    auto y = b0[k] * x + s1[k];
+                    s1[k] = b1[k] * x - a1[k] * y + s2[k];
+                    s2[k] = b2[k] * x - a2[k] * y;
+                    x = y;
+                });
+
+                data[i] = x;
+            }
+
+            unroll(biquads, [&](int k)
+            {
+                biquadSections[k].s1 = s1[k];
+                biquadSections[k].s2 = s2[k];
+            });
+
+            unroll(svfs, [&](int k)
+            {
+                svfSections[k].s1 = ic1[k];
+                svfSections[k].s2 = ic2[k];
+            });
+        }
+        else
+        {
+            (void)sections; (void)data; (void)num;
+        }
+    }
+
+    // Row NumBiquads of the table, indexed by the number of SVFs; counts that
+    // add up to more than maxCascadeSections never happen and get a harmless stand-in.
+    template<int NumBiquads, int... SvfCounts>
+    static constexpr KernelRow makeKernelRow(std::integer_sequence<int, SvfCounts...>)
+    {
+        return { { &processSections<NumBiquads, (NumBiquads + SvfCounts <= maxCascadeSections ? SvfCounts : 0)>... } };
+    }
+
+    template<int... BiquadCounts>
+    static constexpr KernelTable makeKernels(std::integer_sequence<int, BiquadCounts...>)
+    {
+        return { { makeKernelRow<BiquadCounts>(std::make_integer_sequence<int, maxCascadeSections + 1>())... } };
+    }
+
+    static constexpr KernelTable kernels = makeKernels(std::make_integer_sequence<int, maxCascadeSections + 1>());
+
+    void interleave(int group, SampleType* const* channels, int numChannels, int start, int num)
+    {
+        auto* raw = reinterpret_cast<SampleType*>(getGroupFrames(group));
+        const auto firstChannel = group * numLanes;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            if (firstChannel + lane < numChannels)
+            {
+                const auto* source = channels[firstChannel + lane] + start;
+                for (int i = 0; i < num; ++i)
+                    raw[i * numLanes + lane] = source[i];
+            }
+            else
+            {
+                for (int i = 0; i < num; ++i)
+                    raw[i * numLanes + lane] = 0;
+            }
+        }
+    }
+
+    void deinterleave(int group, SampleType* const* channels, int numChannels, int start, int num) const
+    {
+        const auto* raw = reinterpret_cast<const SampleType*>(getGroupFrames(group));
+        const auto firstChannel = group * numLanes;
+
+        for (int lane = 0; lane < numLanes && firstChannel + lane < numChannels; ++lane)
+        {
+            auto* destination = channels[firstChannel + lane] + start;
+            for (int i = 0; i < num; ++i)
+                destination[i] = raw[i * numLanes + lane];
+        }
+    }
+};
+
+/**
+ The same cascade for one channel at a time, a block of SIMDNumElements
+ samples per step.
+
+ A biquad's output over a block is fully determined by its two state values
+ and the block's input:
+
+     y = T x + P1 s1 + P2 s2
+
+ where column j of T is the section's impulse response delayed by j samples,
+ and P1 and P2 are its responses to a unit s1 or s2 with no input. Every
+ output lane is independent of the others, so the serial recurrence becomes
+ SIMDNumElements multiply-adds of broadcast inputs against precomputed
+ columns, using the full register width on a single channel. The state at
+ the end of the block comes straight from the last two inputs and outputs,
+ exactly as the recurrence would have left it.
+
+ T, P1 and P2 are worked out in double for each new design. While
+ coefficients ramp towards it, and for samples left over at the end of a
+ buffer, the channel runs through the plain recurrence instead.
+
+ Sections that ask for the state-variable topology, which are the ones a
+ float biquad can't place precisely, run serially before the block-processed
+ biquads, in the same order as CascadeEngine keeps them.
+ */
+template<typename Vec>
+class BlockStateSpaceEngine final : public FilterCascadeEngine<typename Vec::ElementType>
+{
+public:
+    using SampleType = typename Vec::ElementType;
+
+    static constexpr int blockLength = (int)Vec::SIMDNumElements;
+    static_assert(blockLength >= 2, "the end state needs the last two samples of a block");
+
+    void prepare(int numChannels, int) override
+    {
+        preparedChannels = numChannels;
+        states.allocate((size_t)(numChannels * maxCascadeSections));
+        numActiveSections = 0;
+
+        reset();
+    }
+
+    void reset() override
+    {
+        for (int i = 0; i < preparedChannels * maxCascadeSections; ++i)
+            states[(size_t)i] = {};
+    }
+
+    void setSections(const CascadeSections& unordered, int rampSamples) override
+    {
+        CascadeSections packed;
+        const auto newNumSvfs = orderByTopology(unordered, packed);
+
+        bool layoutChanged = packed.numSections != numActiveSections || newNumSvfs != numSvfs;
+
+        for (int i = 0; i < packed.numSections && !layoutChanged; ++i)
+            layoutChanged = packed.sections[i].slot != activeSlots[i];
+
+        if (layoutChanged)
+        {
+            int sources[maxCascadeSections];
+            StateConversion conversions[maxCascadeSections];
+            findPreviousSections(packed, newNumSvfs, activeSlots, numActiveSections, numSvfs, ramp, sources, conversions);
+
+            for (int channel = 0; channel < preparedChannels; ++channel)
+            {
+                auto* channelStates = getChannelStates(channel);
+                State previous[maxCascadeSections];
+
+                for (int j = 0; j < numActiveSections; ++j)
+                    previous[j] = channelStates[j];
+
+                for (int i = 0; i < packed.numSections; ++i)
+                {
+                    const auto j = sources[i];
+                    channelStates[i] = {};
+
+                    if (j < 0)
+                        continue;
+
+                    if ((j < numSvfs) == (i < newNumSvfs))
+                    {
+                        channelStates[i] = previous[j];
+                    }
+                    else
+                    {
+                        const auto& m = conversions[i];
+                        channelStates[i].s1 = (SampleType)(m.m11 * previous[j].s1 + m.m12 * previous[j].s2);
+                        channelStates[i].s2 = (SampleType)(m.m21 * previous[j].s1 + m.m22 * previous[j].s2);
+                    }
+                }
+            }
+        }
+
+        ramp.start(packed, activeSlots, numActiveSections, rampSamples);
+
+        for (int i = newNumSvfs; i < packed.numSections; ++i)
+            sections[i] = makeSection(packed.sections[i].coefficients);
+
+        for (int i = 0; i < packed.numSections; ++i)
+            activeSlots[i] = packed.sections[i].slot;
+
+        numActiveSections = packed.numSections;
+        numSvfs = newNumSvfs;
+        writeCoefficients();
+    }
+
+    void process(SampleType* const* channels, int numChannels, int numSamples) override
+    {
+        if (numChannels > preparedChannels)
+            numChannels = preparedChannels;
+
+        int start = 0;
+
+        while (start < numSamples && ramp.isRamping())
+        {
+            const auto segment = numSamples - start < samplesUntilStep ? numSamples - start : samplesUntilStep;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int k = 0; k < numActiveSections; ++k)
+                    processSerially(k, getChannelStates(channel)[k], channels[channel] + start, segment);
+
+            start += segment;
+
+            if ((samplesUntilStep -= segment) == 0)
+            {
+                ramp.advance();
+                writeCoefficients();
+                samplesUntilStep = coefficientControlInterval;
+            }
+        }
+
+        samplesUntilStep = CoefficientRamp::advanceGrid(samplesUntilStep, numSamples - start);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* data = channels[channel];
+            auto* channelStates = getChannelStates(channel);
+            int position = start;
+
+            for (int k = 0; k < numSvfs; ++k)
+                processSerially(k, channelStates[k], data + start, numSamples - start);
+
+            if (numSvfs < numActiveSections)
+            {
+                for (; position + blockLength <= numSamples; position += blockLength)
+                    processBlock(channelStates, data + position);
+
+                for (int k = numSvfs; k < numActiveSections; ++k)
+                    processSerially(k, channelStates[k], data + position, numSamples - position);
+            }
+        }
+    }
+
+    // Built for a single channel, which has nothing to share out.
+    void setTaskRunner(TaskRunner*) override {}
+private:
+    struct Section
+    {
+        // For the newest design, biquads only.
+        Vec columns[(size_t)blockLength];
+        Vec p1, p2;
+
+        // Where the ramp has got to, which is the newest design once it ends:
+        // the biquad, or Simper's a1, a2 and a3 and the output mix of the SVF.
+        SampleType b0, b1, b2, a1, a2;
+        SampleType g1, g2, g3, m0, m1, m2;
+    };
+
+    struct State
+    {
+        SampleType s1{}, s2{};
+    };
+
+    int preparedChannels = 0;
+
+    Section sections[maxCascadeSections];
+    int activeSlots[maxCascadeSections]{};
+    int numActiveSections = 0;
+    int numSvfs = 0;
+
+    CoefficientRamp ramp;
+    int samplesUntilStep = coefficientControlInterval;
+
+    // maxCascadeSections per channel, of which the first numActiveSections are live.
+    HeapArray<State> states;
+
+    State* getChannelStates(int channel) { return states.get() + channel * maxCascadeSections; }
+
+    void writeCoefficients()
+    {
+        for (int i = numSvfs; i < numActiveSections; ++i)
+        {
+            const auto c = ramp.getCoefficients(i);
+            auto& section = sections[i];
+            section.b0 = (SampleType)c.b0; section.b1 = (SampleType)c.b1; section.b2 = (SampleType)c.b2;
+            section.a1 = (SampleType)c.a1; section.a2 = (SampleType)c.a2;
+        }
+
+        for (int i = 0; i < numSvfs; ++i)
+        {
+            const auto c = ramp.getStateVariable(i);
+            const auto a1 = 1.0 / (1.0 + c.g * (c.g + c.k));
+            auto& section = sections[i];
+            section.g1 = (SampleType)a1; section.g2 = (SampleType)(c.g * a1); section.g3 = (SampleType)(c.g * c.g * a1);
+            section.m0 = (SampleType)c.m0; section.m1 = (SampleType)c.m1; section.m2 = (SampleType)c.m2;
+        }
+    }
+
+    static Section makeSection(const BiquadCoefficients& c)
+    {
+        // Run the recurrence in double from a unit impulse and from each unit state.
+        auto respond = [&c](double x0, double s1, double s2, SampleType* out)
+        {
+            for (int n = 0; n < blockLength; ++n)
+            {
+                const auto x = n == 0 ? x0 : 0.0;
+                const auto y = c.b0 * x + s1;
+                s1 = c.b1 * x - c.a1 * y + s2;
+                s2 = c.b2 * x - c.a2 * y;
+                out[n] = (SampleType)y;
+            }
+        };
+
+        Vec scratch[1];
+        auto* raw = reinterpret_cast<SampleType*>(scratch);
+
+        SampleType impulse[(size_t)blockLength];
+        respond(1.0, 0.0, 0.0, impulse);
+
+        Section section;
+
+        for (int j = 0; j < blockLength; ++j)
+        {
+            for (int n = 0; n < blockLength; ++n)
+                raw[n] = n >= j ? impulse[n - j] : SampleType(0);
+
+            section.columns[j] = Vec::fromRawArray(raw);
+        }
+
+        respond(0.0, 1.0, 0.0, raw);
+        section.p1 = Vec::fromRawArray(raw);
+
+        respond(0.0, 0.0, 1.0, raw);
+        section.p2 = Vec::fromRawArray(raw);
+
+        return section;
+    }
+
+    void processBlock(State* channelStates, SampleType* data) const
+    {
+        Vec block[1];
+        auto* x = reinterpret_cast<SampleType*>(block);
+
+        for (int n = 0; n < blockLength; ++n)
+            x[n] = data[n];
+
+        for (int k = numSvfs; k < numActiveSections; ++k)
+        {
+            const auto& section = sections[k];
+            auto& state = channelStates[k];
+
+            // Two accumulators so consecutive multiply-adds don't wait on each other.
+            auto even = section.p1 * Vec::expand(state.s1);
+            auto odd = section.p2 * Vec::expand(state.s2);
+
+            for (int j = 0; j < blockLength; j += 2)
+            {
+                even = even + section.columns[j] * Vec::expand(x[j]);
+                odd = odd + section.columns[j + 1] * Vec::expand(x[j + 1]);
+            }
+
+            const auto xLast = x[blockLength - 1];
+            const auto xPrevious = x[blockLength - 2];
+
+            (even + odd).copyToRawArray(x);
+
+            const auto yLast = x[blockLength - 1];
+            const auto yPrevious = x[blockLength - 2];
+
+            state.s2 = section.b2 * xLast - section.a2 * yLast;
+            state.s1 = section.b1 * xLast - section.a1 * yLast + section.b2 * xPrevious - section.a2 * yPrevious;
+        }
+
+        for (int n = 0; n < blockLength; ++n)
+            data[n] = x[n];
+    }
+
+    void processSerially(int k, State& state, SampleType* data, int num) const
+    {
+        const auto& section = sections[k];
+
+        if (k < numSvfs)
+        {
+            for (int i = 0; i < num; ++i)
+            {
+                const auto x = data[i];
+                const auto v3 = x - state.s2;
+                const auto v1 = section.g1 * state.s1 + section.g2 * v3;
+                const auto v2 = state.s2 + section.g2 * state.s1 + section.g3 * v3;
+                state.s1 = v1 + v1 - state.s1;
+                state.s2 = v2 + v2 - state.s2;
+                data[i] = section.m0 * x + section.m1 * v1 + section.m2 * v2;
+            }
+
+            return;
+        }
+
+        for (int i = 0; i < num; ++i)
+        {
+            const auto x = data[i];
+            const auto y = section.b0 * x + state.s1;
+            state.s1 = section.b1 * x - section.a1 * y + state.s2;
+            state.s2 = section.b2 * x - section.a2 * y;
+            data[i] = y;
+        }
+    }
+};
+
+/**
+ 2x and 4x oversampling for every channel at once, channels interleaved into
+ the lanes of a register as in CascadeEngine.
+
+ Each 2x stage is a polyphase IIR half-band filter: two chains of first-order
+ allpasses running at the lower rate. Going up, each input sample goes
+ through both chains and they give the two output samples; going down, each
+ pair of input samples goes one through each chain and the results are
+ averaged. Nothing runs at the higher rate that doesn't have to, and a 4x
+ pass is a 2x pass followed by a cheaper second stage.
+ */
+template<typename Vec>
+class HalfBandOversampler final : public OversamplingEngine<typename Vec::ElementType>
+{
+public:
+    using SampleType = typename Vec::ElementType;
+
+    static constexpr int numLanes = (int)Vec::SIMDNumElements;
+
+    HalfBandOversampler()
+    {
+        double first[firstHalfBandCoefficients], second[secondHalfBandCoefficients];
+        makeHalfBandAllpass(first, firstHalfBandCoefficients, firstHalfBandTransition);
+        makeHalfBandAllpass(second, secondHalfBandCoefficients, secondHalfBandTransition);
+
+        for (int i = 0; i < firstHalfBandCoefficients; ++i)
+            firstCoefficients[i] = Vec::expand((SampleType)first[i]);
+
+        for (int i = 0; i < secondHalfBandCoefficients; ++i)
+            secondCoefficients[i] = Vec::expand((SampleType)second[i]);
+    }
+
+    void prepare(int numChannels, int maximumBlockSize) override
+    {
+        preparedChannels = numChannels;
+        blockSize = maximumBlockSize > 1 ? maximumBlockSize : 1;
+        numGroups = (numChannels + numLanes - 1) / numLanes;
+
+        states.allocate((size_t)numGroups);
+        baseFrames.allocate((size_t)(numGroups * blockSize));
+        doubleFrames.allocate((size_t)(numGroups * 2 * blockSize));
+        quadFrames.allocate((size_t)(numGroups * maxOversamplingFactor * blockSize));
+
+        const auto channelSize = (size_t)(maxOversamplingFactor * blockSize);
+        oversampled.allocate((size_t)numChannels * channelSize);
+        oversampledChannels.allocate((size_t)numChannels);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            oversampledChannels[(size_t)channel] = oversampled.get() + (size_t)channel * channelSize;
+
+        reset();
+    }
+
+    void reset() override
+    {
+        for (int group = 0; group < numGroups; ++group)
+            states[(size_t)group] = {};
+    }
+
+    SampleType* const* processUp(const SampleType* const* channels, int numChannels, int numSamples, int factor) override
+    {
+        if (numChannels > preparedChannels)
+            numChannels = preparedChannels;
+
+        GroupCall call { this, channels, nullptr, numChannels, numSamples, factor };
+        runGroups(call, &processUpTask);
+        return oversampledChannels.get();
+    }
+
+    void processDown(SampleType* const* channels, int numChannels, int numSamples, int factor) override
+    {
+        if (numChannels > preparedChannels)
+            numChannels = preparedChannels;
+
+        GroupCall call { this, nullptr, channels, numChannels, numSamples, factor };
+        runGroups(call, &processDownTask);
+    }
+
+    void setTaskRunner(TaskRunner* runner) override { taskRunner = runner; }
+private:
+    struct GroupCall
+    {
+        HalfBandOversampler* engine;
+        const SampleType* const* input;
+        SampleType* const* output;
+        int numChannels, numSamples, factor;
+    };
+
+    void runGroups(GroupCall& call, void (*task)(void*, int))
+    {
+        const auto numUsedGroups = (call.numChannels + numLanes - 1) / numLanes;
+
+        if (taskRunner != nullptr && numUsedGroups > 1)
+            taskRunner->run(numUsedGroups, task, &call);
+        else
+            for (int group = 0; group < numUsedGroups; ++group)
+                task(&call, group);
+    }
+
+    // Each group has its own state and frames, so groups can run on different threads.
+    static void processUpTask(void* context, int group)
+    {
+        const auto& call = *static_cast<const GroupCall*>(context);
+        auto& engine = *call.engine;
+        auto& state = engine.states[(size_t)group];
+        auto* base = engine.getBaseFrames(group);
+        auto* doubled = engine.getDoubleFrames(group);
+        auto* quad = engine.getQuadFrames(group);
+        auto* result = doubled;
+
+        interleave(call.input, call.numChannels, group, base, call.numSamples);
+        upsample<firstHalfBandCoefficients>(engine.firstCoefficients, state.firstUp, base, doubled, call.numSamples);
+
+        if (call.factor > 2)
+        {
+            upsample<secondHalfBandCoefficients>(engine.secondCoefficients, state.secondUp, doubled, quad, 2 * call.numSamples);
+            result = quad;
+        }
+
+        deinterleave(result, engine.oversampledChannels.get(), call.numChannels, group, call.numSamples * call.factor);
+    }
+
+    static void processDownTask(void* context, int group)
+    {
+        const auto& call = *static_cast<const GroupCall*>(context);
+        auto& engine = *call.engine;
+        auto& state = engine.states[(size_t)group];
+        auto* base = engine.getBaseFrames(group);
+        auto* doubled = engine.getDoubleFrames(group);
+        auto* quad = engine.getQuadFrames(group);
+
+        if (call.factor > 2)
+        {
+            interleave(engine.oversampledChannels.get(), call.numChannels, group, quad, 4 * call.numSamples);
+            downsample<secondHalfBandCoefficients>(engine.secondCoefficients, state.secondDown, quad, doubled, 2 * call.numSamples);
+        }
+        else
+        {
+            interleave(engine.oversampledChannels.get(), call.numChannels, group, doubled, 2 * call.numSamples);
+        }
+
+        downsample<firstHalfBandCoefficients>(engine.firstCoefficients, state.firstDown, doubled, base, call.numSamples);
+        deinterleave(base, call.output, call.numChannels, group, call.numSamples);
+    }
+
+    static constexpr int maxCoefficients = firstHalfBandCoefficients > secondHalfBandCoefficients
+                                         ? firstHalfBandCoefficients : secondHalfBandCoefficients;
+
+    struct AllpassChain
+    {
+        Vec x[maxCoefficients], y[maxCoefficients];
+    };
+
+    struct GroupState
+    {
+        AllpassChain firstUp, secondUp, secondDown, firstDown;
+    };
+
+    Vec firstCoefficients[firstHalfBandCoefficients], secondCoefficients[secondHalfBandCoefficients];
+
+    int preparedChannels = 0;
+    int blockSize = 0;
+    int numGroups = 0;
+
+    HeapArray<GroupState> states;
+
+    // Every group's frames at each rate.
+    HeapArray<Vec> baseFrames, doubleFrames, quadFrames;
+
+    TaskRunner* taskRunner = nullptr;
+
+    Vec* getBaseFrames(int group) const { return baseFrames.get() + group * blockSize; }
+    Vec* getDoubleFrames(int group) const { return doubleFrames.get() + group * 2 * blockSize; }
+    Vec* getQuadFrames(int group) const { return quadFrames.get() + group * maxOversamplingFactor * blockSize; }
+
+    // maxOversamplingFactor * blockSize per channel.
+    HeapArray<SampleType> oversampled;
+    HeapArray<SampleType*> oversampledChannels;
+
+    // Allpass stage k: y = c (x - y[-1]) + x[-1], with the even stages on one
+    // branch and the odd on the other.
+    template<int NumCoefficients>
+    static void upsample(const Vec* coefficients, AllpassChain& chain, const Vec* in, Vec* out, int num)
+    {
+        Vec c[(size_t)NumCoefficients], x[(size_t)NumCoefficients], y[(size_t)NumCoefficients];
+
+        for (int k = 0; k < NumCoefficients; ++k)
+        {
+            c[k] = coefficients[k];
+            x[k] = chain.x[k];
+            y[k] = chain.y[k];
+        }
+
+        for (int i = 0; i < num; ++i)
+        {
+            auto even = in[i], odd = in[i];
+
+            for (int k = 0; k < NumCoefficients; k += 2)
+            {
+                const auto e = (even - y[k]) * c[k] + x[k];
+                x[k] = even; y[k] = e; even = e;
+
+                const auto o = (odd - y[k + 1]) * c[k + 1] + x[k + 1];
+                x[k + 1] = odd; y[k + 1] = o; odd = o;
+            }
+
+            out[2 * i] = even;
+            out[2 * i + 1] = odd;
+        }
+
+        for (int k = 0; k < NumCoefficients; ++k)
+        {
+            chain.x[k] = x[k];
+            chain.y[k] = y[k];
+        }
+    }
+
+    template<int NumCoefficients>
+    static void downsample(const Vec* coefficients, AllpassChain& chain, const Vec* in, Vec* out, int num)
+    {
+        Vec c[(size_t)NumCoefficients], x[(size_t)NumCoefficients], y[(size_t)NumCoefficients];
+
+        for (int k = 0; k < NumCoefficients; ++k)
+        {
+            c[k] = coefficients[k];
+            x[k] = chain.x[k];
+            y[k] = chain.y[k];
+        }
+
+        const auto half = Vec::expand((SampleType)0.5);
+
+        for (int i = 0; i < num; ++i)
+        {
+            auto even = in[2 * i + 1], odd = in[2 * i];
+
+            for (int k = 0; k < NumCoefficients; k += 2)
+            {
+                const auto e = (even - y[k]) * c[k] + x[k];
+                x[k] = even; y[k] = e; even = e;
+
+                const auto o = (odd - y[k + 1]) * c[k + 1] + x[k + 1];
+                x[k + 1] = odd; y[k + 1] = o; odd = o;
+            }
+
+            out[i] = (even + odd) * half;
+        }
+
+        for (int k = 0; k < NumCoefficients; ++k)
+        {
+            chain.x[k] = x[k];
+            chain.y[k] = y[k];
+        }
+    }
+
+    static void interleave(const SampleType* const* channels, int numChannels, int group, Vec* frames, int num)
+    {
+        auto* raw = reinterpret_cast<SampleType*>(frames);
+        const auto firstChannel = group * numLanes;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            if (firstChannel + lane < numChannels)
+            {
+                const auto* source = channels[firstChannel + lane];
+                for (int i = 0; i < num; ++i)
+                    raw[i * numLanes + lane] = source[i];
+            }
+            else
+            {
+                for (int i = 0; i < num; ++i)
+                    raw[i * numLanes + lane] = 0;
+            }
+        }
+    }
+
+    static void deinterleave(const Vec* frames, SampleType* const* channels, int numChannels, int group, int num)
+    {
+        const auto* raw = reinterpret_cast<const SampleType*>(frames);
+        const auto firstChannel = group * numLanes;
+
+        for (int lane = 0; lane < numLanes && firstChannel + lane < numChannels; ++lane)
+        {
+            auto* destination = channels[firstChannel + lane];
+            for (int i = 0; i < num; ++i)
+                destination[i] = raw[i * numLanes + lane];
+        }
+    }
+};
+
+//==============================================================================
+template<typename Vec>
+void applyWindow(float* data, const float* window, int numSamples)
+{
+    for (int i = 0; i < numSamples; i += (int)Vec::SIMDNumElements)
+        (Vec::loadUnaligned(data + i) * Vec::loadUnaligned(window + i)).storeUnaligned(data + i);
+}
+
+/*
+ log10 to about 1e-5, plenty for a display: with v = 2^e * m and m in [1, 2),
+ log2 m = 2 atanh(t) / ln 2 where t = (m - 1) / (m + 1) is at most 1/3, so four
+ terms of the atanh series are enough. Zero and denormals come out around -38,
+ well below any floor the analyzer uses.
+ */
+template<typename Vec>
+Vec approximateLog10(Vec v)
+{
+    Vec exponent, mantissa;
+    Vec::splitExponent(v, exponent, mantissa);
+
+    const auto one = Vec::expand(1.0f);
+    const auto t = (mantissa - one) / (mantissa + one);
+    const auto tSquared = t * t;
+
+    auto series = Vec::expand(1.0f / 7.0f);
+    series = series * tSquared + Vec::expand(1.0f / 5.0f);
+    series = series * tSquared + Vec::expand(1.0f / 3.0f);
+    series = series * tSquared + one;
+
+    return exponent * Vec::expand(0.30102999566f) + t * series * Vec::expand(0.86858896381f);
+}
+
+template<typename Vec>
+void magnitudesToDecibels(float* data, int numBins, float scale, float minusInfinityDb)
+{
+    const auto scaleVec = Vec::expand(scale);
+    const auto floor = Vec::expand(minusInfinityDb);
+    const auto twenty = Vec::expand(20.0f);
+
+    for (int i = 0; i < numBins; i += (int)Vec::SIMDNumElements)
+    {
+        auto v = Vec::finitePositiveOrZero(Vec::loadUnaligned(data + i)) * scaleVec;
+        Vec::max(floor, approximateLog10(v) * twenty).storeUnaligned(data + i);
+    }
+}
+
+template<typename Vec>
+void evaluateMagnitudeSquared(const MagnitudeResponseSection* sections, int numSections,
+                              const double* cosW, const double* cos2W, double* result, int numPoints)
+{
+    for (int i = 0; i < numPoints; i += (int)Vec::SIMDNumElements)
+    {
+        const auto c1 = Vec::loadUnaligned(cosW + i);
+        const auto c2 = Vec::loadUnaligned(cos2W + i);
+
+        auto numerator = Vec::expand(1.0);
+        auto denominator = Vec::expand(1.0);
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            const auto& section = sections[s];
+            numerator = numerator * (Vec::expand(section.n0) + Vec::expand(section.n1) * c1 + Vec::expand(section.n2) * c2);
+            denominator = denominator * (Vec::expand(section.d0) + Vec::expand(section.d1) * c1 + Vec::expand(section.d2) * c2);
+        }
+
+        (numerator / denominator).storeUnaligned(result + i);
+    }
+}
+
+template<typename Vec>
+void multiplyAccumulateSpectra(float* accReal, float* accImag,
+                               const float* xReal, const float* xImag,
+                               const float* hReal, const float* hImag, int numBins)
+{
+    for (int i = 0; i < numBins; i += (int)Vec::SIMDNumElements)
+    {
+        const auto xr = Vec::loadUnaligned(xReal + i), xi = Vec::loadUnaligned(xImag + i);
+        const auto hr = Vec::loadUnaligned(hReal + i), hi = Vec::loadUnaligned(hImag + i);
+
+        (Vec::loadUnaligned(accReal + i) + xr * hr - xi * hi).storeUnaligned(accReal + i);
+        (Vec::loadUnaligned(accImag + i) + xr * hi + xi * hr).storeUnaligned(accImag + i);
+    }
+}
+
+template<typename Vec>
+typename Vec::ElementType findPeakMagnitude(const typename Vec::ElementType* data, int numSamples)
+{
+    using SampleType = typename Vec::ElementType;
+    constexpr int numLanes = (int)Vec::SIMDNumElements;
+
+    const auto zero = Vec::expand(0);
+    auto peaks = zero;
+    int i = 0;
+
+    for (; i + numLanes <= numSamples; i += numLanes)
+    {
+        const auto v = Vec::loadUnaligned(data + i);
+        peaks = Vec::max(peaks, Vec::max(v, zero - v));
+    }
+
+    SampleType lanes[(size_t)numLanes];
+    peaks.storeUnaligned(lanes);
+
+    SampleType peak = 0;
+
+    for (auto lane : lanes)
+        peak = lane > peak ? lane : peak;
+
+    for (; i < numSamples; ++i)
+    {
+        const auto magnitude = data[i] < 0 ? -data[i] : data[i];
+        peak = magnitude > peak ? magnitude : peak;
+    }
+
+    return peak;
+}
+
+template<typename Vec>
+void crossfade(const typename Vec::ElementType* from, const typename Vec::ElementType* to,
+               typename Vec::ElementType* destination, int numSamples)
+{
+    using SampleType = typename Vec::ElementType;
+    constexpr int numLanes = (int)Vec::SIMDNumElements;
+
+    if (numSamples <= 0)
+        return;
+
+    const auto step = (SampleType)1 / (SampleType)numSamples;
+    SampleType offsets[(size_t)numLanes];
+
+    for (int lane = 0; lane < numLanes; ++lane)
+        offsets[lane] = (SampleType)(lane + 1) * step;
+
+    const auto laneOffsets = Vec::loadUnaligned(offsets);
+    int i = 0;
+
+    for (; i + numLanes <= numSamples; i += numLanes)
+    {
+        const auto amount = Vec::expand((SampleType)i * step) + laneOffsets;
+        const auto a = Vec::loadUnaligned(from + i);
+        (a + (Vec::loadUnaligned(to + i) - a) * amount).storeUnaligned(destination + i);
+    }
+
+    for (; i < numSamples; ++i)
+        destination[i] = from[i] + (to[i] - from[i]) * ((SampleType)(i + 1) * step);
+}
+
+template<typename Vec>
+FilterCascadeEngine<typename Vec::ElementType>* createCascadeEngine()
+{
+    return new CascadeEngine<Vec>();
+}
+
+template<typename Vec>
+FilterCascadeEngine<typename Vec::ElementType>* createBlockStateSpaceEngine()
+{
+    return new BlockStateSpaceEngine<Vec>();
+}
+
+template<typename Vec>
+OversamplingEngine<typename Vec::ElementType>* createOversampler()
+{
+    return new HalfBandOversampler<Vec>();
+}
+
+template<typename FloatVec, typename DoubleVec>
+DspKernels makeDspKernels(SimdInstructionSet instructionSet)
+{
+    return { instructionSet,
+             (int)FloatVec::SIMDNumElements,
+             (int)DoubleVec::SIMDNumElements,
+             &createCascadeEngine<FloatVec>,
+             &createCascadeEngine<DoubleVec>,
+             &createBlockStateSpaceEngine<FloatVec>,
+             &createBlockStateSpaceEngine<DoubleVec>,
+             &createOversampler<FloatVec>,
+             &createOversampler<DoubleVec>,
+             &applyWindow<FloatVec>,
+             &magnitudesToDecibels<FloatVec>,
+             &evaluateMagnitudeSquared<DoubleVec>,
+             &multiplyAccumulateSpectra<FloatVec>,
+             &findPeakMagnitude<FloatVec>,
+             &findPeakMagnitude<DoubleVec>,
+             &crossfade<FloatVec>,
+             &crossfade<DoubleVec> };
+}
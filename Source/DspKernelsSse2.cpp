@@ -0,0 +1,82 @@
+#include "DspKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <utility>
+
+#include <emmintrin.h>
+
+namespace sse2Kernels
+{
+    struct FloatVec
+    {
+        using ElementType = float;
+        static constexpr size_t SIMDNumElements = 4;
+
+        __m128 value;
+
+        static FloatVec expand(float s) { return { _mm_set1_ps(s) }; }
+        static FloatVec fromRawArray(const float* a) { return { _mm_load_ps(a) }; }
+        void copyToRawArray(float* a) const { _mm_store_ps(a, value); }
+        static FloatVec loadUnaligned(const float* a) { return { _mm_loadu_ps(a) }; }
+        void storeUnaligned(float* a) const { _mm_storeu_ps(a, value); }
+
+        friend FloatVec operator+(FloatVec a, FloatVec b) { return { _mm_add_ps(a.value, b.value) }; }
+        friend FloatVec operator-(FloatVec a, FloatVec b) { return { _mm_sub_ps(a.value, b.value) }; }
+        friend FloatVec operator*(FloatVec a, FloatVec b) { return { _mm_mul_ps(a.value, b.value) }; }
+        friend FloatVec operator/(FloatVec a, FloatVec b) { return { _mm_div_ps(a.value, b.value) }; }
+
+        static FloatVec max(FloatVec a, FloatVec b) { return { _mm_max_ps(a.value, b.value) }; }
+
+        static FloatVec finitePositiveOrZero(FloatVec v)
+        {
+            const auto infinity = _mm_castsi128_ps(_mm_set1_epi32(0x7f800000));
+            const auto keep = _mm_and_ps(_mm_cmpgt_ps(v.value, _mm_setzero_ps()), _mm_cmplt_ps(v.value, infinity));
+            return { _mm_and_ps(keep, v.value) };
+        }
+
+        static void splitExponent(FloatVec v, FloatVec& exponent, FloatVec& mantissa)
+        {
+            const auto bits = _mm_castps_si128(v.value);
+            const auto biased = _mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff));
+            exponent.value = _mm_cvtepi32_ps(_mm_sub_epi32(biased, _mm_set1_epi32(127)));
+            mantissa.value = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                                           _mm_set1_epi32(0x3f800000)));
+        }
+    };
+
+    struct DoubleVec
+    {
+        using ElementType = double;
+        static constexpr size_t SIMDNumElements = 2;
+
+        __m128d value;
+
+        static DoubleVec expand(double s) { return { _mm_set1_pd(s) }; }
+        static DoubleVec fromRawArray(const double* a) { return { _mm_load_pd(a) }; }
+        void copyToRawArray(double* a) const { _mm_store_pd(a, value); }
+        static DoubleVec loadUnaligned(const double* a) { return { _mm_loadu_pd(a) }; }
+        void storeUnaligned(double* a) const { _mm_storeu_pd(a, value); }
+
+        friend DoubleVec operator+(DoubleVec a, DoubleVec b) { return { _mm_add_pd(a.value, b.value) }; }
+        friend DoubleVec operator-(DoubleVec a, DoubleVec b) { return { _mm_sub_pd(a.value, b.value) }; }
+        friend DoubleVec operator*(DoubleVec a, DoubleVec b) { return { _mm_mul_pd(a.value, b.value) }; }
+        friend DoubleVec operator/(DoubleVec a, DoubleVec b) { return { _mm_div_pd(a.value, b.value) }; }
+
+        static DoubleVec max(DoubleVec a, DoubleVec b) { return { _mm_max_pd(a.value, b.value) }; }
+    };
+
+    #include "DspKernelsImpl.h"
+}
+
+const DspKernels* getSse2DspKernels()
+{
+    static const DspKernels kernels = sse2Kernels::makeDspKernels<sse2Kernels::FloatVec, sse2Kernels::DoubleVec>(SimdInstructionSet::sse2);
+    return &kernels;
+}
+
+#else
+
+const DspKernels* getSse2DspKernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+
+/**
+ A single-producer / single-consumer queue of Capacity slots that are
+ allocated once and then passed back and forth.
+
+ The producer fills a slot in place between beginWrite() and finishWrite(),
+ and the consumer reads one in place between beginRead() and finishRead().
+ Only ownership crosses between threads, never the contents, so nothing is
+ copied and, once every slot has been filled once, nothing allocates.
+
+ A slot being read still counts as ready, so a consumer can keep the one it
+ is showing until something newer arrives and then give that back, along
+ with any it has no use for, in a single finishRead().
+ */
+template<typename T, int Capacity>
+struct Fifo
+{
+    /** Producer only. The next free slot, with whatever it held last time, or nullptr if the consumer has all of them. */
+    T* beginWrite()
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        return size1 > 0 ? &slots[(size_t)start1] : nullptr;
+    }
+
+    /** Producer only. Hands the slot from beginWrite() to the consumer. */
+    void finishWrite() { fifo.finishedWrite(1); }
+
+    /** Consumer only. Filled slots not yet given back, including any being read. */
+    int getNumReady() const { return fifo.getNumReady(); }
+
+    /** Consumer only. The oldest filled slot, lent until finishRead(), or nullptr if there isn't one. */
+    T* beginRead()
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        return size1 > 0 ? &slots[(size_t)start1] : nullptr;
+    }
+
+    /** Consumer only. The filled slot index places after the oldest, lent like beginRead()'s; index must be below getNumReady(). */
+    T* getReady(int index)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(index + 1, start1, size1, start2, size2);
+        jassert(size1 + size2 == index + 1);
+        return index < size1 ? &slots[(size_t)(start1 + index)] : &slots[(size_t)(start2 + index - size1)];
+    }
+
+    /** Consumer only. Gives the numSlots oldest filled slots back to the producer. */
+    void finishRead(int numSlots = 1) { fifo.finishedRead(numSlots); }
+private:
+    // AbstractFifo keeps one slot empty to tell full from empty.
+    std::array<T, (size_t)Capacity + 1> slots{};
+    juce::AbstractFifo fifo{ Capacity + 1 };
+};
@@ -0,0 +1,68 @@
+#include "FilterCascade.h"
+
+float getBlockKernelDeviation(const DspKernels& kernels)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numSamples = 8192;
+    constexpr int blockSize = 500;    // not a multiple of any register width, so the tail path runs too
+
+    ChainSettings settings;
+    settings.lowCutFreq = 20.f;
+    settings.lowCutSlope = Slope::slope48dBPerOctave;
+    settings.peakFreq = 1000.f;
+    settings.peakGainInDecibels = 12.f;
+    settings.peakQuality = 4.f;
+    settings.highCutFreq = 18000.f;
+    settings.highCutSlope = Slope::slope48dBPerOctave;
+
+    FilterCoefficientSet coefficients;
+    coefficients.sampleRate = sampleRate;
+    makeLowCutFilter(settings, sampleRate, coefficients.lowCut);
+    coefficients.peak = makePeakFilter(settings, sampleRate);
+    makeHighCutFilter(settings, sampleRate, coefficients.highCut);
+    coefficients.lowCutSlope = settings.lowCutSlope;
+    coefficients.highCutSlope = settings.highCutSlope;
+
+    const auto packed = packCascadeSections(coefficients);
+
+    std::vector<juce::dsp::IIR::Filter<float>> reference((size_t)packed.numSections);
+
+    for (int i = 0; i < packed.numSections; ++i)
+    {
+        const auto& c = packed.sections[i].coefficients;
+        reference[(size_t)i].coefficients = new juce::dsp::IIR::Coefficients<float>((float)c.b0, (float)c.b1, (float)c.b2,
+                                                                                    1.f, (float)c.a1, (float)c.a2);
+    }
+
+    std::unique_ptr<FilterCascadeEngine<float>> engine(kernels.createFloatBlockCascade());
+    engine->prepare(1, blockSize);
+    engine->setSections(packed, 0);
+
+    juce::Random random(0x5eed);
+    std::vector<float> input((size_t)numSamples), output;
+
+    for (auto& sample : input)
+        sample = random.nextFloat() * 2.f - 1.f;
+
+    output = input;
+
+    for (int start = 0; start < numSamples; start += blockSize)
+    {
+        auto* channel = output.data() + start;
+        engine->process(&channel, 1, juce::jmin(blockSize, numSamples - start));
+    }
+
+    float deviation = 0.f;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        auto x = input[(size_t)n];
+
+        for (auto& filter : reference)
+            x = filter.processSample(x);
+
+        deviation = juce::jmax(deviation, std::abs(x - output[(size_t)n]));
+    }
+
+    return deviation;
+}
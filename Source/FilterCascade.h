@@ -0,0 +1,336 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include "DspKernels.h"
+#include "FilterDesign.h"
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ How far the block engine may stray from a chain of juce::dsp::IIR::Filter.
+ Both round in float, in different orders, and on full-scale noise through
+ every band, including a 20 Hz 48 dB/oct low cut whose poles sit right by the
+ unit circle, they measure about 1.2e-3 apart. Most of that is the
+ recurrence's own rounding: against a double-precision reference the block
+ engine stays within 5e-4.
+ */
+constexpr float blockKernelTolerance = 3.0e-3f;
+
+/**
+ The largest difference between these kernels' block engine and a chain of
+ juce::dsp::IIR::Filter over a demanding set of bands, for checking a kernel
+ build against blockKernelTolerance. It allocates and filters a few thousand
+ samples, so it belongs in a test or benchmark run, never in prepare().
+ */
+float getBlockKernelDeviation(const DspKernels& kernels);
+
+/**
+ The whole EQ as one cascade of biquads that filters every channel at once.
+
+ The work happens in a FilterCascadeEngine from the dispatched kernels:
+ SSE2, AVX2 or AVX-512 on x86 depending on what the CPU can run and how many
+ channels there are, juce::dsp::SIMDRegister everywhere else. prepare() picks
+ the engine, so it is also where a forced instruction set takes effect.
+
+ A single channel has nothing to spread across lanes, so by default it runs
+ on the block state-space engine instead, which spends the register width on
+ consecutive samples. setMonoKernel() can put it back on the interleaved
+ engine, with one lane in use, to compare the two.
+
+ Each band's sections are biquads unless its coefficient set asks for the
+ state-variable topology, which costs a little more per sample but keeps
+ behaving while coefficients move every control interval. A band can switch
+ either way with its next coefficients and its state carries over, though
+ the bands before it follow it to the SVF form (see chooseTopologies).
+
+ Even in a biquad cascade, a float section whose poles sit too close to DC or
+ Nyquist for float coefficients (see minBiquadPoleDistance) runs as an SVF,
+ along with any before it, so a steep low cut at a high sample rate keeps its
+ shape while the bands after it stay on the cheaper form. A band sweeping
+ across that line changes form with its state carried over, and doesn't click.
+
+ It can also run at 2x or 4x the host rate, between the dispatched half-band
+ oversampler's up- and downsampling, for coefficients designed at that rate.
+
+ It is built for float and for double hosts. A double cascade has half the
+ lanes per register, but its biquads place every pole precisely and never
+ need to change form.
+
+ Bypassed and flat bands aren't in the cascade at all, and with none left the
+ engine isn't even called. A band that drops out while ramping first ramps to
+ unity and only leaves once it is there, so it never takes any of the signal
+ with it; one that comes in ramps up from unity the same way.
+ */
+template<typename SampleType>
+class FilterCascade
+{
+public:
+    static_assert(std::is_same_v<SampleType, float> || std::is_same_v<SampleType, double>,
+                  "the kernels are built for float and double");
+
+    enum class MonoKernel
+    {
+        blockStateSpace,
+        interleaved     // the multichannel engine with one lane in use
+    };
+
+    /**
+     Which engine a single channel runs on. prepare() readies both, so this is
+     safe between blocks, but the engine coming in starts from silence.
+     */
+    void setMonoKernel(MonoKernel newKernel)
+    {
+        if (newKernel == monoKernel)
+            return;
+
+        monoKernel = newKernel;
+
+        if (spareMonoEngine != nullptr)
+        {
+            std::swap(engine, spareMonoEngine);
+            std::swap(instructionSet, spareInstructionSet);
+
+            engine->reset();
+            engine->setSections(sections, 0);
+            engine->setTaskRunner(taskRunner);
+        }
+    }
+
+    MonoKernel getMonoKernel() const { return monoKernel; }
+
+    /**
+     Spreads the channels over runner's threads, a register's worth at a
+     time, or keeps them on the calling thread with nullptr. The output is
+     bit-identical either way. Safe to change between blocks.
+     */
+    void setTaskRunner(TaskRunner* runner)
+    {
+        taskRunner = runner;
+
+        if (engine != nullptr)
+            engine->setTaskRunner(runner);
+
+        if (oversampler != nullptr)
+            oversampler->setTaskRunner(runner);
+    }
+
+    /**
+     1, 2 or 4. Safe to call while processing, since prepare() allocates for
+     the largest factor; the oversampler starts again from silence, and the
+     coefficients should be redesigned for the new rate.
+     */
+    void setOversamplingFactor(int newFactor)
+    {
+        jassert(newFactor == 1 || newFactor == 2 || newFactor == maxOversamplingFactor);
+
+        if (newFactor != oversamplingFactor && oversampler != nullptr)
+            oversampler->reset();
+
+        oversamplingFactor = newFactor;
+        latencySamples = juce::roundToInt(getOversamplingLatency(newFactor));
+    }
+
+    int getOversamplingFactor() const { return oversamplingFactor; }
+
+    /** The delay the oversampling adds, in host-rate samples. */
+    int getLatencySamples() const { return latencySamples; }
+
+    void prepare(int numChannels, int maximumBlockSize)
+    {
+        sections = target;
+        samplesUntilRetired = 0;
+
+        const auto& kernels = getDspKernelsForChannels(numChannels, isDouble);
+
+        if constexpr (isDouble)
+            engine.reset(kernels.createDoubleCascade());
+        else
+            engine.reset(kernels.createFloatCascade());
+
+        instructionSet = kernels.instructionSet;
+        preparedBlockSize = juce::jmax(1, maximumBlockSize);
+
+        engine->prepare(numChannels, preparedBlockSize);
+        engine->setSections(sections, 0);
+        spareMonoEngine.reset();
+
+        if (numChannels == 1)
+        {
+            const auto& blockKernels = getDspKernels();
+
+            if constexpr (isDouble)
+                spareMonoEngine.reset(blockKernels.createDoubleBlockCascade());
+            else
+                spareMonoEngine.reset(blockKernels.createFloatBlockCascade());
+
+            spareInstructionSet = blockKernels.instructionSet;
+            spareMonoEngine->prepare(numChannels, preparedBlockSize);
+            spareMonoEngine->setSections(sections, 0);
+
+            if (monoKernel == MonoKernel::blockStateSpace)
+            {
+                std::swap(engine, spareMonoEngine);
+                std::swap(instructionSet, spareInstructionSet);
+            }
+        }
+
+        engine->setTaskRunner(taskRunner);
+
+        const auto& oversamplingKernels = getDspKernelsForChannels(numChannels, isDouble);
+
+        if constexpr (isDouble)
+            oversampler.reset(oversamplingKernels.createDoubleOversampler());
+        else
+            oversampler.reset(oversamplingKernels.createFloatOversampler());
+
+        oversampler->prepare(numChannels, preparedBlockSize);
+        oversampler->setTaskRunner(taskRunner);
+        chunkChannels.resize((size_t)numChannels);
+    }
+
+    void reset()
+    {
+        if (engine != nullptr)
+            engine->reset();
+
+        if (oversampler != nullptr)
+            oversampler->reset();
+    }
+
+    /**
+     Glides to the new coefficients over rampSamples, a step every
+     coefficientControlInterval samples, or jumps straight there if it is 0.
+     */
+    void setCoefficients(const FilterCoefficientSet& coefficients, int rampSamples = 0)
+    {
+        const auto previous = sections;
+
+        target = packCascadeSections(coefficients);
+        chooseTopologies(target);
+        sections = target;
+        samplesUntilRetired = 0;
+
+        // Sections that are leaving stay on as unity until the ramp is over.
+        if (rampSamples > 0)
+        {
+            for (int j = 0; j < previous.numSections; ++j)
+            {
+                bool leaving = true;
+
+                for (int i = 0; i < target.numSections && leaving; ++i)
+                    leaving = target.sections[i].slot != previous.sections[j].slot;
+
+                // Unity gain through the leaving section's own poles.
+                if (leaving)
+                {
+                    const auto& c = previous.sections[j].coefficients;
+                    const auto& svf = previous.sections[j].svf;
+
+                    sections.sections[sections.numSections++] = { previous.sections[j].slot, previous.sections[j].topology,
+                                                                   { 1.0, c.a1, c.a2, c.a1, c.a2 },
+                                                                   { svf.g, svf.k, 1.0, 0.0, 0.0 } };
+                }
+            }
+
+            if (sections.numSections > target.numSections)
+                samplesUntilRetired = rampSamples;
+        }
+
+        if (engine != nullptr)
+            engine->setSections(sections, rampSamples);
+    }
+
+    void process(SampleType* const* channels, int numChannels, int numSamples)
+    {
+        jassert(engine != nullptr);
+
+        if (oversamplingFactor == 1)
+        {
+            if (sections.numSections > 0)
+                processEngine(channels, numChannels, numSamples);
+
+            return;
+        }
+
+        auto* chunk = chunkChannels.data();
+        numChannels = juce::jmin(numChannels, (int)chunkChannels.size());
+
+        for (int start = 0; start < numSamples; start += preparedBlockSize)
+        {
+            const auto num = juce::jmin(preparedBlockSize, numSamples - start);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                chunk[channel] = channels[channel] + start;
+
+            auto* const* upsampled = oversampler->processUp(chunk, numChannels, num, oversamplingFactor);
+
+            if (sections.numSections > 0)
+                processEngine(upsampled, numChannels, num * oversamplingFactor);
+
+            oversampler->processDown(chunk, numChannels, num, oversamplingFactor);
+        }
+    }
+
+    SimdInstructionSet getInstructionSet() const { return instructionSet; }
+private:
+    static constexpr bool isDouble = std::is_same_v<SampleType, double>;
+
+    // Double coefficients place any pole precisely enough, so only float
+    // biquads ever need to change form on their own. The engines run SVFs
+    // first, so every section up to the last that asks for or needs one
+    // becomes an SVF too, which keeps the chain in order as sections change form.
+    static void chooseTopologies(CascadeSections& packed)
+    {
+        int numSvfs = 0;
+
+        for (int i = 0; i < packed.numSections; ++i)
+        {
+            const auto& section = packed.sections[i];
+
+            if (section.topology == SectionTopology::stateVariable
+                || (!isDouble && needsStateVariable(section.coefficients)))
+                numSvfs = i + 1;
+        }
+
+        for (int i = 0; i < packed.numSections; ++i)
+            packed.sections[i].topology = i < numSvfs ? SectionTopology::stateVariable : SectionTopology::biquad;
+    }
+
+    void processEngine(SampleType* const* channels, int numChannels, int numSamples)
+    {
+        engine->process(channels, numChannels, numSamples);
+
+        if (samplesUntilRetired > 0)
+        {
+            samplesUntilRetired -= numSamples;
+
+            if (samplesUntilRetired <= 0)
+            {
+                sections = target;
+                engine->setSections(sections, 0);
+            }
+        }
+    }
+
+    std::unique_ptr<FilterCascadeEngine<SampleType>> engine;
+
+    // With one channel, whichever engine setMonoKernel() isn't using, ready to swap in.
+    MonoKernel monoKernel = MonoKernel::blockStateSpace;
+    std::unique_ptr<FilterCascadeEngine<SampleType>> spareMonoEngine;
+    SimdInstructionSet spareInstructionSet = SimdInstructionSet::generic;
+
+    // What the engine is running, which is the target plus any sections still
+    // ramping to unity on their way out.
+    CascadeSections target{}, sections{};
+    int samplesUntilRetired = 0;
+    SimdInstructionSet instructionSet = SimdInstructionSet::generic;
+    TaskRunner* taskRunner = nullptr;
+
+    std::unique_ptr<OversamplingEngine<SampleType>> oversampler;
+    std::vector<SampleType*> chunkChannels;
+    int oversamplingFactor = 1, latencySamples = 0, preparedBlockSize = 1;
+};
@@ -0,0 +1,324 @@
+#include "FilterDesign.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+/*
+ Everything in here writes straight into caller-owned storage: no
+ Coefficients objects, no ReferenceCountedArray, no heap. A band costs one
+ tan() (or one sin/cos pair for the peak, a few more transcendentals for the
+ matched peak) plus a handful of multiplies per section, so it is as safe to
+ run on the audio thread as the filters are.
+
+ The bilinear results match juce::dsp::FilterDesign and IIR::Coefficients,
+ which are the transforms the plugin has always used.
+ */
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    // 1 / Q of each second-order section of an even-order Butterworth filter,
+    // 2 cos((2k + 1) pi / 2N), for N = 2, 4, 6 and 8 (12 to 48 dB/oct).
+    constexpr double butterworthInverseQ[maxCutSections][maxCutSections]
+    {
+        { 1.4142135623730951 },
+        { 1.8477590650225735, 0.7653668647301797 },
+        { 1.9318516525781366, 1.4142135623730951, 0.5176380902050415 },
+        { 1.9615705608064609, 1.6629392246050905, 1.1111404660392046, 0.39018064403225666 }
+    };
+
+    // The bilinear transform maps Nyquist to infinity, so keep the corner just below it.
+    double getWarpedFrequency(double frequency, double sampleRate)
+    {
+        auto limited = std::clamp(frequency, 1.0, sampleRate * 0.4999);
+        return std::tan(pi * limited / sampleRate);
+    }
+
+    /*
+     Martin Vicanek's "Matched Second Order Digital Filters" (2016): the poles
+     are the analog ones mapped exactly by z = e^(s T), and the numerator is
+     whatever matches the analog magnitude at DC, at the centre and in the flat
+     slope there. Both are written in terms of
+     |H|^2 = (B0 phi0 + B1 phi1 + B2 phi2) / (A0 phi0 + A1 phi1 + A2 phi2),
+     phi1 = sin^2(w / 2), phi0 = 1 - phi1, phi2 = 4 phi0 phi1.
+
+     The prototype is the cookbook's, so frequency, gain and Q mean what they
+     do for the bilinear design. A cut is the boost of the opposite gain turned
+     upside down, which keeps the two mirror images as they are in analog.
+     */
+    BiquadCoefficients makeMatchedPeakFilter(double frequency, double gainInDecibels, double quality, double sampleRate)
+    {
+        const auto gain = std::pow(10.0, std::abs(gainInDecibels) / 20.0);
+        const auto omega = 2.0 * pi * std::clamp(frequency, 2.0, sampleRate * 0.4999) / sampleRate;
+
+        // The denominator's damping, 1 / (2 Q sqrt(G)); past 1 the poles are real.
+        const auto zeta = 1.0 / (2.0 * quality * std::sqrt(gain));
+        const auto decay = std::exp(-zeta * omega);
+        const auto a1 = zeta <= 1.0 ? -2.0 * decay * std::cos(std::sqrt(1.0 - zeta * zeta) * omega)
+                                    : -2.0 * decay * std::cosh(std::sqrt(zeta * zeta - 1.0) * omega);
+        const auto a2 = decay * decay;
+
+        const auto A0 = (1.0 + a1 + a2) * (1.0 + a1 + a2);
+        const auto A1 = (1.0 - a1 + a2) * (1.0 - a1 + a2);
+        const auto A2 = -4.0 * a2;
+
+        const auto halfSine = std::sin(omega / 2.0);
+        const auto phi1 = halfSine * halfSine;
+        const auto phi0 = 1.0 - phi1;
+        const auto phi2 = 4.0 * phi0 * phi1;
+
+        // G^2 times the denominator at the centre, and its slope there.
+        const auto R1 = (A0 * phi0 + A1 * phi1 + A2 * phi2) * gain * gain;
+        const auto R2 = (-A0 + A1 + 4.0 * (phi0 - phi1) * A2) * gain * gain;
+
+        const auto B0 = A0;
+        const auto B2 = (R1 - R2 * phi1 - B0) / (4.0 * phi1 * phi1);
+        const auto B1 = R2 + B0 + 4.0 * (phi1 - phi0) * B2;
+
+        // Back from |numerator|^2 to the minimum-phase numerator.
+        const auto rootB0 = std::sqrt(B0);
+        const auto rootB1 = std::sqrt(std::max(0.0, B1));
+        const auto W = 0.5 * (rootB0 + rootB1);
+        const auto b0 = 0.5 * (W + std::sqrt(std::max(0.0, W * W + B2)));
+        const auto b1 = 0.5 * (rootB0 - rootB1);
+        const auto b2 = -B2 / (4.0 * b0);
+
+        if (gainInDecibels >= 0.0)
+            return { b0, b1, b2, a1, a2 };
+
+        return { 1.0 / b0, a1 / b0, a2 / b0, b1 / b0, b2 / b0 };
+    }
+}
+
+BiquadCoefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    if (chainSettings.peakDesign == PeakDesign::matched)
+        return makeMatchedPeakFilter(chainSettings.peakFreq, chainSettings.peakGainInDecibels,
+                                     chainSettings.peakQuality, sampleRate);
+
+    const auto gain = std::pow(10.0, chainSettings.peakGainInDecibels / 20.0);
+    const auto A = std::sqrt(gain);
+    const auto omega = 2.0 * pi * std::max((double)chainSettings.peakFreq, 2.0) / sampleRate;
+    const auto alpha = std::sin(omega) / (chainSettings.peakQuality * 2.0);
+    const auto c2 = -2.0 * std::cos(omega);
+    const auto alphaTimesA = alpha * A;
+    const auto alphaOverA = alpha / A;
+    const auto a0 = 1.0 + alphaOverA;
+
+    return { (1.0 + alphaTimesA) / a0,
+             c2 / a0,
+             (1.0 - alphaTimesA) / a0,
+             c2 / a0,
+             (1.0 - alphaOverA) / a0 };
+}
+
+void makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate, CutCoefficients& sections)
+{
+    const auto numSections = getNumCutSections(chainSettings.lowCutSlope);
+    const auto* inverseQ = butterworthInverseQ[numSections - 1];
+
+    const auto n = getWarpedFrequency(chainSettings.lowCutFreq, sampleRate);
+    const auto nSquared = n * n;
+
+    for (int i = 0; i < numSections; ++i)
+    {
+        const auto c1 = 1.0 / (1.0 + inverseQ[i] * n + nSquared);
+        sections[(size_t)i] = { c1,
+                                -2.0 * c1,
+                                c1,
+                                c1 * 2.0 * (nSquared - 1.0),
+                                c1 * (1.0 - inverseQ[i] * n + nSquared) };
+    }
+}
+
+void makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate, CutCoefficients& sections)
+{
+    const auto numSections = getNumCutSections(chainSettings.highCutSlope);
+    const auto* inverseQ = butterworthInverseQ[numSections - 1];
+
+    const auto n = 1.0 / getWarpedFrequency(chainSettings.highCutFreq, sampleRate);
+    const auto nSquared = n * n;
+
+    for (int i = 0; i < numSections; ++i)
+    {
+        const auto c1 = 1.0 / (1.0 + inverseQ[i] * n + nSquared);
+        sections[(size_t)i] = { c1,
+                                2.0 * c1,
+                                c1,
+                                c1 * 2.0 * (1.0 - nSquared),
+                                c1 * (1.0 - inverseQ[i] * n + nSquared) };
+    }
+}
+
+SvfCoefficients toStateVariable(const BiquadCoefficients& c)
+{
+    // The SVF's denominator, scaled by D = 1 + gk + g^2, is
+    // D + 2(g^2 - 1) z^-1 + (1 - gk + g^2) z^-2; evaluating it at z = 1 and
+    // z = -1 gives 4g^2 and 4, which pins down g and then k.
+    const auto p = 1.0 + c.a1 + c.a2;
+    const auto q = 1.0 - c.a1 + c.a2;
+    const auto g = std::sqrt(p / q);
+    const auto k = 2.0 * (1.0 - c.a2) / (q * g);
+
+    // Then match the numerator, scaled the same way, to m0 + m1 BP + m2 LP.
+    const auto d = 1.0 + g * k + g * g;
+    const auto b0 = c.b0 * d, b1 = c.b1 * d, b2 = c.b2 * d;
+
+    SvfCoefficients svf;
+    svf.g = g;
+    svf.k = k;
+    svf.m0 = (b0 - b1 + b2) / 4.0;
+    svf.m1 = (b0 - b2 - 2.0 * g * k * svf.m0) / (2.0 * g);
+    svf.m2 = (b0 + b1 + b2) / (4.0 * g * g) - svf.m0;
+    return svf;
+}
+
+double getMagnitudeForFrequency(const BiquadCoefficients& c, double frequency, double sampleRate)
+{
+    const auto w = 2.0 * pi * frequency / sampleRate;
+    const auto z1 = std::polar(1.0, -w);
+    const auto z2 = z1 * z1;
+
+    auto numerator = c.b0 + c.b1 * z1 + c.b2 * z2;
+    auto denominator = 1.0 + c.a1 * z1 + c.a2 * z2;
+
+    return std::abs(numerator / denominator);
+}
+
+double getMagnitudeForFrequency(const FilterCoefficientSet& set, double frequency)
+{
+    double mag = 1.0;
+
+    if (set.sampleRate <= 0.0)
+        return mag;
+
+    if (set.isLowCutActive())
+        for (int i = 0; i < getNumCutSections(set.lowCutSlope); ++i)
+            mag *= getMagnitudeForFrequency(set.lowCut[(size_t)i], frequency, set.sampleRate);
+
+    if (set.isPeakActive())
+        mag *= getMagnitudeForFrequency(set.peak, frequency, set.sampleRate);
+
+    if (set.isHighCutActive())
+        for (int i = 0; i < getNumCutSections(set.highCutSlope); ++i)
+            mag *= getMagnitudeForFrequency(set.highCut[(size_t)i], frequency, set.sampleRate);
+
+    return mag;
+}
+
+int getActiveBands(const FilterCoefficientSet& set)
+{
+    return (set.isLowCutActive() ? lowCutBandActive : 0)
+         | (set.isPeakActive() ? peakBandActive : 0)
+         | (set.isHighCutActive() ? highCutBandActive : 0);
+}
+
+bool isFlat(const BiquadCoefficients* sections, int numSections, double sampleRate)
+{
+    const auto tolerance = std::pow(10.0, flatToleranceDecibels / 20.0);
+    const auto highest = std::min(20000.0, sampleRate * 0.49);
+
+    // Twelfth-octave steps: nothing a band can be set to fits between two of them.
+    for (auto frequency = 20.0; frequency <= highest; frequency *= 1.0594630943592953)
+    {
+        double magnitude = 1.0;
+
+        for (int i = 0; i < numSections; ++i)
+            magnitude *= getMagnitudeForFrequency(sections[i], frequency, sampleRate);
+
+        if (magnitude > tolerance || magnitude * tolerance < 1.0)
+            return false;
+    }
+
+    return true;
+}
+
+double getDecayTime(const FilterCoefficientSet& set, double decayInDecibels)
+{
+    if (set.sampleRate <= 0.0)
+        return 0.0;
+
+    const auto logDecay = decayInDecibels / 20.0 * std::log(10.0);
+
+    auto getDecaySamples = [logDecay](const BiquadCoefficients& c)
+    {
+        // The poles are the roots of z^2 + a1 z + a2; complex ones share the radius sqrt(a2).
+        const auto discriminant = c.a1 * c.a1 - 4.0 * c.a2;
+        const auto radius = discriminant < 0.0 ? std::sqrt(c.a2)
+                                               : (std::abs(c.a1) + std::sqrt(discriminant)) / 2.0;
+
+        // Two samples of numerator either way; a section with poles at 0 has nothing else.
+        if (radius <= 0.0)
+            return 2.0;
+
+        return 2.0 + logDecay / std::log(std::min(radius, 1.0 - 1e-12));
+    };
+
+    double samples = 0.0;
+
+    if (set.isLowCutActive())
+        for (int i = 0; i < getNumCutSections(set.lowCutSlope); ++i)
+            samples += getDecaySamples(set.lowCut[(size_t)i]);
+
+    if (set.isPeakActive())
+        samples += getDecaySamples(set.peak);
+
+    if (set.isHighCutActive())
+        for (int i = 0; i < getNumCutSections(set.highCutSlope); ++i)
+            samples += getDecaySamples(set.highCut[(size_t)i]);
+
+    return samples / set.sampleRate;
+}
+
+void makeHalfBandAllpass(double* coefficients, int numCoefficients, double transitionBandwidth)
+{
+    // The elliptic modulus k and nome q of the transition band, then each
+    // coefficient from theta-function series that converge within a few terms.
+    auto k = std::tan((1.0 - transitionBandwidth * 2.0) * pi / 4.0);
+    k *= k;
+
+    const auto kRoot = std::pow(1.0 - k * k, 0.25);
+    const auto e = 0.5 * (1.0 - kRoot) / (1.0 + kRoot);
+    const auto e4 = e * e * e * e;
+    const auto q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+    const auto order = numCoefficients * 2 + 1;
+
+    for (int index = 0; index < numCoefficients; ++index)
+    {
+        const auto c = index + 1;
+
+        double numerator = 0.0, term = 0.0;
+        for (int i = 0, sign = 1; i == 0 || std::abs(term) > 1e-100; ++i, sign = -sign)
+        {
+            term = std::pow(q, i * (i + 1)) * std::sin((i * 2 + 1) * c * pi / order) * sign;
+            numerator += term;
+        }
+
+        double denominator = 0.0;
+        for (int i = 1, sign = -1; i == 1 || std::abs(term) > 1e-100; ++i, sign = -sign)
+        {
+            term = std::pow(q, i * i) * std::cos(i * 2 * c * pi / order) * sign;
+            denominator += term;
+        }
+
+        const auto ww = numerator * std::pow(q, 0.25) / (denominator + 0.5);
+        const auto wwSquared = ww * ww;
+        const auto x = std::sqrt((1.0 - wwSquared * k) * (1.0 - wwSquared / k)) / (1.0 + wwSquared);
+
+        coefficients[index] = (1.0 - x) / (1.0 + x);
+    }
+}
+
+double getHalfBandLatency(const double* coefficients, int numCoefficients)
+{
+    // Each allpass delays DC by (1 - c) / (1 + c) samples of the lower rate;
+    // the branches are averaged, and up and down each add half their sum.
+    double delay = 0.0;
+
+    for (int i = 0; i < numCoefficients; ++i)
+        delay += (1.0 - coefficients[i]) / (1.0 + coefficients[i]);
+
+    return delay;
+}
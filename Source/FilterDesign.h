@@ -0,0 +1,125 @@
+#pragma once
+
+#include "FilterSections.h"
+
+#include <array>
+
+enum class Slope
+{
+    slope12dBPerOctave,
+    slope24dBPerOctave,
+    slope36dBPerOctave,
+    slope48dBPerOctave
+};
+
+/**
+ How the peak band is taken from its analog prototype. The bilinear transform
+ is the classic RBJ cookbook filter, which squeezes everything towards Nyquist:
+ a 10 kHz bell at 48 kHz comes out narrower and lopsided. The matched design
+ keeps the analog shape up to Nyquist instead, without having to oversample.
+ */
+enum class PeakDesign
+{
+    bilinear,
+    matched
+};
+
+struct ChainSettings {
+    float lowCutFreq{ 20.f };
+    float highCutFreq{ 20000.f };
+    float peakFreq{ 750.f };
+    float peakGainInDecibels{ 0.0f };
+    float peakQuality{ 1.0f };
+    PeakDesign peakDesign{ PeakDesign::bilinear };
+
+    Slope lowCutSlope{ Slope::slope12dBPerOctave };
+    Slope highCutSlope{ Slope::slope12dBPerOctave };
+
+    bool lowCutBypassed{ false }, peakBypassed{ false }, highCutBypassed{ false };
+
+    SectionTopology lowCutTopology{ SectionTopology::biquad };
+    SectionTopology peakTopology{ SectionTopology::biquad };
+    SectionTopology highCutTopology{ SectionTopology::biquad };
+};
+
+inline int getNumCutSections(Slope slope) { return static_cast<int>(slope) + 1; }
+
+/** A section that passes everything through unchanged. */
+constexpr BiquadCoefficients identityBiquad{ 1.0, 0.0, 0.0, 0.0, 0.0 };
+
+/**
+ The SVF with exactly the response of a stable biquad. Any second-order
+ numerator is some mix of the three outputs, so nothing is lost in the
+ conversion, whichever way the biquad was designed.
+ */
+SvfCoefficients toStateVariable(const BiquadCoefficients& biquad);
+
+using CutCoefficients = std::array<BiquadCoefficients, maxCutSections>;
+
+/**
+ Every coefficient the chain needs for one set of parameters. Designed off the
+ audio thread and then only ever read, by both the processor and the editor.
+ */
+struct FilterCoefficientSet
+{
+    double sampleRate{ 0.0 };
+
+    CutCoefficients lowCut{ { identityBiquad, identityBiquad, identityBiquad, identityBiquad } };
+    BiquadCoefficients peak{ identityBiquad };
+    CutCoefficients highCut{ { identityBiquad, identityBiquad, identityBiquad, identityBiquad } };
+
+    Slope lowCutSlope{ Slope::slope12dBPerOctave };
+    Slope highCutSlope{ Slope::slope12dBPerOctave };
+
+    bool lowCutBypassed{ false }, peakBypassed{ false }, highCutBypassed{ false };
+
+    // How each band's sections run; the response is the same either way.
+    SectionTopology lowCutTopology{ SectionTopology::biquad };
+    SectionTopology peakTopology{ SectionTopology::biquad };
+    SectionTopology highCutTopology{ SectionTopology::biquad };
+
+    // Set by the designer for bands within flatToleranceDecibels of unity.
+    bool lowCutFlat{ false }, peakFlat{ false }, highCutFlat{ false };
+
+    /** Bypassed and flat bands are left out of the cascade altogether. */
+    bool isLowCutActive() const { return !lowCutBypassed && !lowCutFlat; }
+    bool isPeakActive() const { return !peakBypassed && !peakFlat; }
+    bool isHighCutActive() const { return !highCutBypassed && !highCutFlat; }
+};
+
+/** Flags for the bands a coefficient set actually filters with. */
+enum ActiveBand
+{
+    lowCutBandActive = 1 << 0,
+    peakBandActive = 1 << 1,
+    highCutBandActive = 1 << 2
+};
+
+int getActiveBands(const FilterCoefficientSet& coefficients);
+
+/**
+ The most a band may deviate from unity, anywhere from 20 Hz to 20 kHz (or
+ as close to Nyquist as the rate allows), and still count as flat: well below
+ the smallest level difference anyone can hear.
+ */
+constexpr double flatToleranceDecibels = 0.05;
+
+bool isFlat(const BiquadCoefficients* sections, int numSections, double sampleRate);
+
+BiquadCoefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
+void makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate, CutCoefficients& sections);
+void makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate, CutCoefficients& sections);
+
+double getMagnitudeForFrequency(const BiquadCoefficients& coefficients, double frequency, double sampleRate);
+
+/** The magnitude of every active section in the set multiplied together. */
+double getMagnitudeForFrequency(const FilterCoefficientSet& coefficients, double frequency);
+
+/**
+ How long, in seconds, the active sections keep ringing after the input stops
+ before they have fallen to decayInDecibels (-120, say): each section's
+ slowest pole takes ln(decay) / ln(radius) samples, and the cascade is given
+ the sum, a bound on how long each section's tail can keep feeding the next.
+ */
+double getDecayTime(const FilterCoefficientSet& coefficients, double decayInDecibels);
+
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+ The coefficient types FilterDesign produces and the kernels consume.
+
+ Like DspKernels.h, this is compiled into the translation units built with
+ AVX2 and AVX-512 enabled, so it holds plain structs and declarations only.
+ That rules out default member initialisers too: they give a struct a
+ constructor that every includer compiles, and the linker may keep the
+ AVX-512 copy. FilterDesign.h has identityBiquad for a sensible default.
+ */
+
+constexpr int maxCutSections = 4;
+
+/**
+ One second-order section, normalised so that a0 == 1.
+ */
+struct BiquadCoefficients
+{
+    double b0, b1, b2;
+    double a1, a2;
+};
+
+/**
+ The same section as a topology-preserving-transform state-variable filter
+ (Andrew Simper's form): g = tan(pi fc / fs) sets the frequency, k the damping
+ (1 / Q for a plain low or high pass), and m0, m1 and m2 mix the input,
+ band-pass and low-pass outputs into the response. Any positive g and k give
+ a stable filter, so unlike biquad coefficients these can be interpolated or
+ modulated freely.
+ */
+struct SvfCoefficients
+{
+    double g, k;
+    double m0, m1, m2;
+};
+
+/**
+ How a section computes its output. Both give the same response; the
+ state-variable form costs more per sample but stays well-behaved while its
+ parameters move.
+ */
+enum class SectionTopology
+{
+    biquad,         // transposed direct form II
+    stateVariable   // TPT SVF, see SvfCoefficients
+};
+
+/**
+ A polyphase IIR half-band low-pass (Valenzuela and Constantinides, in the
+ form Laurent de Soras' HIIR uses): two branches of first-order allpasses in
+ z^-2, the even-indexed coefficients in one and the odd in the other, averaged.
+ transitionBandwidth is a fraction of the higher rate, centred on a quarter of
+ it; numCoefficients must be even.
+ */
+void makeHalfBandAllpass(double* coefficients, int numCoefficients, double transitionBandwidth);
+
+/** The delay an upsampler and downsampler built on these add at low frequencies, in samples at the lower rate. */
+double getHalfBandLatency(const double* coefficients, int numCoefficients);
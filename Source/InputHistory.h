@@ -0,0 +1,68 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+/**
+ The most recent input, every channel, in a ring a power of two long.
+
+ Bypass plays the input back from here delayed by the plugin's latency, so the
+ host's compensation stays right, and the filters run over it when they come
+ back in so they pick up where they would have been. Writing and reading are
+ plain copies; nothing allocates once prepared.
+ */
+template<typename SampleType>
+struct InputHistory
+{
+    /** Holds at least capacity samples of each channel. */
+    void prepare(int numChannels, int capacity)
+    {
+        samples.setSize(numChannels, juce::nextPowerOfTwo(juce::jmax(1, capacity)));
+        mask = samples.getNumSamples() - 1;
+        reset();
+    }
+
+    void reset()
+    {
+        samples.clear();
+        writePosition = 0;
+    }
+
+    int getCapacity() const { return samples.getNumSamples(); }
+
+    void push(const SampleType* const* channels, int numChannels, int numSamples)
+    {
+        jassert(numChannels <= samples.getNumChannels() && numSamples <= getCapacity());
+
+        const auto first = juce::jmin(numSamples, getCapacity() - writePosition);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            samples.copyFrom(channel, writePosition, channels[channel], first);
+            samples.copyFrom(channel, 0, channels[channel] + first, numSamples - first);
+        }
+
+        writePosition = (writePosition + numSamples) & mask;
+    }
+
+    /**
+     Copies numSamples of input ending samplesAgo before the newest pushed, so
+     samplesAgo = latency gives the block just pushed, delayed by latency.
+     Anything from before the last reset comes out as silence.
+     */
+    void read(SampleType* const* destination, int numChannels, int numSamples, int samplesAgo) const
+    {
+        jassert(numChannels <= samples.getNumChannels() && samplesAgo + numSamples <= getCapacity());
+
+        const auto start = (writePosition - samplesAgo - numSamples) & mask;
+        const auto first = juce::jmin(numSamples, getCapacity() - start);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            juce::FloatVectorOperations::copy(destination[channel], samples.getReadPointer(channel, start), first);
+            juce::FloatVectorOperations::copy(destination[channel] + first, samples.getReadPointer(channel), numSamples - first);
+        }
+    }
+private:
+    juce::AudioBuffer<SampleType> samples;
+    int mask = 0, writePosition = 0;
+};
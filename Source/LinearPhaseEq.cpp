@@ -0,0 +1,632 @@
+#include "LinearPhaseEq.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    int roundUpToPadding(int size)
+    {
+        return (size + dspKernelPadding - 1) / dspKernelPadding * dspKernelPadding;
+    }
+
+    // Real-only FFT results hold bin k at [2k] and [2k + 1].
+    void splitBins(const float* interleaved, float* real, float* imag, int numBins)
+    {
+        for (int k = 0; k < numBins; ++k)
+        {
+            real[k] = interleaved[2 * k];
+            imag[k] = interleaved[2 * k + 1];
+        }
+    }
+
+    void interleaveBins(const float* real, const float* imag, float* interleaved, int numBins)
+    {
+        for (int k = 0; k < numBins; ++k)
+        {
+            interleaved[2 * k] = real[k];
+            interleaved[2 * k + 1] = imag[k];
+        }
+    }
+
+    // Partition p of the kernel meets the input from p partitions ago, in a ring with the newest at ringHead.
+    void multiplyAccumulatePartitions(const DspKernels& dsp, float* accReal, float* accImag,
+                                      const float* inputReal, const float* inputImag, int ringHead,
+                                      const float* kernelReal, const float* kernelImag,
+                                      int numPartitions, int paddedBins)
+    {
+        std::fill(accReal, accReal + paddedBins, 0.0f);
+        std::fill(accImag, accImag + paddedBins, 0.0f);
+
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            auto slot = ringHead + p;
+            if (slot >= numPartitions)
+                slot -= numPartitions;
+
+            dsp.multiplyAccumulateSpectra(accReal, accImag,
+                                          inputReal + slot * paddedBins, inputImag + slot * paddedBins,
+                                          kernelReal + p * paddedBins, kernelImag + p * paddedBins,
+                                          paddedBins);
+        }
+    }
+}
+
+LinearPhaseEq::LinearPhaseEq(TripleBuffer<FilterCoefficientSet>& mailbox)
+    : coefficientMailbox(mailbox)
+{
+    designThread->addTimeSliceClient(this);
+}
+
+LinearPhaseEq::~LinearPhaseEq()
+{
+    stopTailThread();
+    designThread->removeTimeSliceClient(this);
+}
+
+void LinearPhaseEq::prepare(double sampleRate, int numChannels, int maximumBlockSize)
+{
+    stopTailThread();
+
+    const juce::ScopedLock sl(designLock);
+
+    preparedRate = sampleRate;
+    firLength = juce::nextPowerOfTwo(juce::roundToInt(sampleRate * minimumFirSeconds));
+    partitionSize = juce::jlimit(minPartitionSize, firLength, juce::nextPowerOfTwo(maximumBlockSize));
+    numBins = partitionSize + 1;
+    paddedBins = roundUpToPadding(numBins);
+    latencySamples = partitionSize + firLength / 2;
+
+    // The head covers 2T taps, or all of them when the FIR is no longer than that.
+    tailSize = tailPartitionRatio * partitionSize;
+    numPartitions = juce::jmin(firLength, 2 * tailSize) / partitionSize;
+    numTailPartitions = juce::jmax(0, firLength / tailSize - 2);
+    numTailBins = tailSize + 1;
+    paddedTailBins = roundUpToPadding(numTailBins);
+
+    const auto firOrder = juce::roundToInt(std::log2((double)firLength));
+    const auto partitionOrder = juce::roundToInt(std::log2((double)partitionSize)) + 1;
+    const auto tailOrder = partitionOrder + juce::roundToInt(std::log2((double)tailPartitionRatio));
+    const auto tailBufferSize = numTailPartitions > 0 ? 2 * tailSize : 0;
+
+    // Design thread.
+    firFft = std::make_unique<juce::dsp::FFT>(firOrder);
+    designPartitionFft = std::make_unique<juce::dsp::FFT>(partitionOrder);
+    designTailFft = numTailPartitions > 0 ? std::make_unique<juce::dsp::FFT>(tailOrder) : nullptr;
+
+    const auto numPoints = roundUpToPadding(firLength / 2 + 1);
+    cosW.assign((size_t)numPoints, 1.0);
+    cos2W.assign((size_t)numPoints, 1.0);
+    magnitudes.assign((size_t)numPoints, 0.0);
+    curveRate = 0.0;
+
+    // One more point than taps, so the window is symmetric about firLength / 2.
+    window.assign((size_t)firLength + 1, 0.0f);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), window.size(),
+                                                             juce::dsp::WindowingFunction<float>::blackman, false);
+
+    taps.assign((size_t)(2 * firLength), 0.0f);
+    designBuffer.assign((size_t)(4 * partitionSize), 0.0f);
+    designTailBuffer.assign((size_t)(2 * tailBufferSize), 0.0f);
+    kernels = std::make_unique<Fifo<FirPartitionSpectra, numKernelSlots>>();
+
+    // Audio thread.
+    dsp = &getDspKernels();
+
+    channels.resize((size_t)numChannels);
+
+    for (auto& state : channels)
+    {
+        state.input.assign((size_t)(2 * partitionSize), 0.0f);
+        state.output.assign((size_t)partitionSize, 0.0f);
+        state.inputReal.assign((size_t)(numPartitions * paddedBins), 0.0f);
+        state.inputImag.assign((size_t)(numPartitions * paddedBins), 0.0f);
+
+        state.fft = std::make_unique<juce::dsp::FFT>(partitionOrder);
+        state.fftBuffer.assign((size_t)(4 * partitionSize), 0.0f);
+        state.accReal.assign((size_t)paddedBins, 0.0f);
+        state.accImag.assign((size_t)paddedBins, 0.0f);
+        state.fadeOutput.assign((size_t)partitionSize, 0.0f);
+
+        state.tailInput.assign((size_t)tailBufferSize, 0.0f);
+        state.tailOutput.assign((size_t)tailBufferSize, 0.0f);
+        state.tailHistory.assign((size_t)tailBufferSize, 0.0f);
+        state.tailInputReal.assign((size_t)(numTailPartitions * paddedTailBins), 0.0f);
+        state.tailInputImag.assign((size_t)(numTailPartitions * paddedTailBins), 0.0f);
+    }
+
+    // Tail thread.
+    tailFft = numTailPartitions > 0 ? std::make_unique<juce::dsp::FFT>(tailOrder) : nullptr;
+    tailFftBuffer.assign((size_t)(2 * tailBufferSize), 0.0f);
+    tailAccReal.assign((size_t)(numTailPartitions > 0 ? paddedTailBins : 0), 0.0f);
+    tailAccImag.assign((size_t)(numTailPartitions > 0 ? paddedTailBins : 0), 0.0f);
+    tailFadeOutput.assign((size_t)(tailBufferSize / 2), 0.0f);
+
+    // The first kernel goes straight in, from the newest coefficients there are.
+    coefficientMailbox.acquire();
+    kernelOutOfDate = !designKernel(coefficientMailbox.getReadBuffer());
+
+    // Without any, it starts silent.
+    if (kernelOutOfDate)
+    {
+        auto* silent = kernels->beginWrite();
+        silent->real.assign((size_t)(numPartitions * paddedBins), 0.0f);
+        silent->imag.assign((size_t)(numPartitions * paddedBins), 0.0f);
+        silent->tailReal.assign((size_t)(numTailPartitions * paddedTailBins), 0.0f);
+        silent->tailImag.assign((size_t)(numTailPartitions * paddedTailBins), 0.0f);
+        kernels->finishWrite();
+    }
+
+    currentKernel = kernels->beginRead();
+    nextKernel = nullptr;
+
+    reset();
+
+    if (numTailPartitions > 0)
+    {
+        tailThread = std::make_unique<TailThread>(*this);
+        tailThread->startThread(juce::Thread::Priority::high);
+    }
+}
+
+void LinearPhaseEq::reset()
+{
+    finishTailJob();
+
+    // With no history there is nothing to fade from.
+    if (nextKernel != nullptr)
+    {
+        kernels->finishRead(kernelsToRelease);
+        currentKernel = nextKernel;
+        nextKernel = nullptr;
+    }
+
+    for (auto& state : channels)
+    {
+        std::fill(state.input.begin(), state.input.end(), 0.0f);
+        std::fill(state.output.begin(), state.output.end(), 0.0f);
+        std::fill(state.inputReal.begin(), state.inputReal.end(), 0.0f);
+        std::fill(state.inputImag.begin(), state.inputImag.end(), 0.0f);
+
+        std::fill(state.tailInput.begin(), state.tailInput.end(), 0.0f);
+        std::fill(state.tailOutput.begin(), state.tailOutput.end(), 0.0f);
+        std::fill(state.tailHistory.begin(), state.tailHistory.end(), 0.0f);
+        std::fill(state.tailInputReal.begin(), state.tailInputReal.end(), 0.0f);
+        std::fill(state.tailInputImag.begin(), state.tailInputImag.end(), 0.0f);
+    }
+
+    ringHead = 0;
+    position = 0;
+    tailRingHead = 0;
+    tailPosition = 0;
+    tailHalf = 0;
+    priming = false;
+}
+
+void LinearPhaseEq::startPriming(int numSamples)
+{
+    reset();
+    priming = true;
+    primingSamples = numSamples;
+}
+
+template<typename SampleType>
+void LinearPhaseEq::process(SampleType* const* channelData, int numChannels, int numSamples)
+{
+    priming = false;
+    numChannels = juce::jmin(numChannels, (int)channels.size());
+
+    for (int done = 0; done < numSamples;)
+    {
+        const auto num = juce::jmin(numSamples - done, partitionSize - position);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* data = channelData[channel] + done;
+            auto& state = channels[(size_t)channel];
+
+            std::copy(data, data + num, state.input.data() + partitionSize + position);
+            std::copy(state.output.data() + position, state.output.data() + position + num, data);
+        }
+
+        position += num;
+        done += num;
+
+        if (position == partitionSize)
+        {
+            processPartition(numChannels);
+            position = 0;
+        }
+    }
+}
+
+template void LinearPhaseEq::process(float* const*, int, int);
+template void LinearPhaseEq::process(double* const*, int, int);
+
+template<typename SampleType>
+void LinearPhaseEq::prime(const SampleType* const* channelData, int numChannels, int numSamples)
+{
+    jassert(priming);
+    numChannels = juce::jmin(numChannels, (int)channels.size());
+
+    for (int done = 0; done < numSamples;)
+    {
+        const auto num = juce::jmin(numSamples - done, partitionSize - position);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* data = channelData[channel] + done;
+            std::copy(data, data + num, channels[(size_t)channel].input.data() + partitionSize + position);
+        }
+
+        position += num;
+        done += num;
+        primingSamples -= num;
+
+        if (position == partitionSize)
+        {
+            processPartition(numChannels);
+            position = 0;
+        }
+    }
+}
+
+template void LinearPhaseEq::prime(const float* const*, int, int);
+template void LinearPhaseEq::prime(const double* const*, int, int);
+
+void LinearPhaseEq::processPartition(int numChannels)
+{
+    // Without a tail a new kernel fades in straight away; with one, queueTailJob() sets the partition.
+    if (nextKernel == nullptr && numTailPartitions == 0)
+    {
+        const auto numReady = kernels->getNumReady();
+
+        if (numReady > 1)
+        {
+            nextKernel = kernels->getReady(numReady - 1);
+            kernelsToRelease = numReady - 1;
+            partitionsUntilSwitch = 1;
+        }
+    }
+
+    fading = nextKernel != nullptr && --partitionsUntilSwitch == 0;
+
+    // Priming, only the last partition before process() takes over plays out.
+    partitionHeard = !priming || primingSamples < partitionSize;
+
+    ringHead = (ringHead == 0 ? numPartitions : ringHead) - 1;
+
+    if (taskRunner != nullptr && numChannels > 1)
+    {
+        taskRunner->run(numChannels, [](void* context, int channel)
+        {
+            auto& eq = *static_cast<LinearPhaseEq*>(context);
+            eq.processChannelPartition(eq.channels[(size_t)channel]);
+        }, this);
+    }
+    else
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            processChannelPartition(channels[(size_t)channel]);
+    }
+
+    // The older slots go back, including any that never got played.
+    if (fading)
+    {
+        kernels->finishRead(kernelsToRelease);
+        currentKernel = nextKernel;
+        nextKernel = nullptr;
+    }
+
+    if (numTailPartitions > 0)
+    {
+        tailPosition += partitionSize;
+
+        if (tailPosition == tailSize)
+        {
+            finishTailJob();
+            queueTailJob(numChannels);
+            tailHalf = 1 - tailHalf;
+            tailPosition = 0;
+        }
+    }
+}
+
+void LinearPhaseEq::processChannelPartition(ChannelState& state)
+{
+    auto& fftBuffer = state.fftBuffer;
+
+    std::copy(state.input.begin(), state.input.end(), fftBuffer.begin());
+    std::fill(fftBuffer.begin() + 2 * partitionSize, fftBuffer.end(), 0.0f);
+    state.fft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+    splitBins(fftBuffer.data(),
+              state.inputReal.data() + ringHead * paddedBins,
+              state.inputImag.data() + ringHead * paddedBins,
+              numBins);
+
+    if (partitionHeard)
+    {
+        convolve(*currentKernel, state, state.output.data());
+
+        if (fading)
+        {
+            auto& fadeOutput = state.fadeOutput;
+            convolve(*nextKernel, state, fadeOutput.data());
+
+            for (int i = 0; i < partitionSize; ++i)
+            {
+                const auto t = (float)(i + 1) / (float)partitionSize;
+                state.output[(size_t)i] += (fadeOutput[(size_t)i] - state.output[(size_t)i]) * t;
+            }
+        }
+    }
+
+    // The tail's share of these samples, and this partition's input for its next block.
+    if (numTailPartitions > 0)
+    {
+        const auto offset = tailHalf * tailSize + tailPosition;
+
+        if (partitionHeard)
+            for (int i = 0; i < partitionSize; ++i)
+                state.output[(size_t)i] += state.tailOutput[(size_t)(offset + i)];
+
+        std::copy(state.input.begin() + partitionSize, state.input.end(), state.tailInput.begin() + offset);
+    }
+
+    // Overlap-save: the newer half becomes the older one.
+    std::copy(state.input.begin() + partitionSize, state.input.end(), state.input.begin());
+}
+
+void LinearPhaseEq::convolve(const FirPartitionSpectra& kernel, ChannelState& state, float* destination)
+{
+    auto& fftBuffer = state.fftBuffer;
+
+    multiplyAccumulatePartitions(*dsp, state.accReal.data(), state.accImag.data(),
+                                 state.inputReal.data(), state.inputImag.data(), ringHead,
+                                 kernel.real.data(), kernel.imag.data(), numPartitions, paddedBins);
+
+    interleaveBins(state.accReal.data(), state.accImag.data(), fftBuffer.data(), numBins);
+    state.fft->performRealOnlyInverseTransform(fftBuffer.data());
+
+    // The first half wrapped around; the second is the linear convolution.
+    std::copy(fftBuffer.begin() + partitionSize, fftBuffer.begin() + 2 * partitionSize, destination);
+}
+
+void LinearPhaseEq::queueTailJob(int numChannels)
+{
+    tailJobFadeFrom = nullptr;
+
+    // This job's output is first played from the partition after the next T
+    // samples, so that is where a new kernel can start.
+    if (nextKernel == nullptr)
+    {
+        const auto numReady = kernels->getNumReady();
+
+        if (numReady > 1)
+        {
+            nextKernel = kernels->getReady(numReady - 1);
+            kernelsToRelease = numReady - 1;
+            partitionsUntilSwitch = tailSize / partitionSize + 1;
+            tailJobFadeFrom = currentKernel;
+        }
+    }
+
+    tailJobKernel = nextKernel != nullptr ? nextKernel : currentKernel;
+    tailJobHalf = tailHalf;
+    tailJobChannels = numChannels;
+
+    // Priming runs the jobs here. The output of the last two, and of the one
+    // before when the last partition ends a block, is still to be heard.
+    if (priming)
+    {
+        tailJobHeard = primingSamples < 2 * tailSize + partitionSize;
+        runTailJob();
+        return;
+    }
+
+    tailJobHeard = true;
+    tailJobState.store(tailJobQueued, std::memory_order_release);
+    tailThread->notify();
+}
+
+void LinearPhaseEq::finishTailJob()
+{
+    // Normally long done. If the thread never got to it this one does it instead,
+    // and if the thread is part way through, that can't be long.
+    if (runQueuedTailJob())
+        return;
+
+    while (tailJobState.load(std::memory_order_acquire) != tailJobIdle)
+        juce::Thread::yield();
+}
+
+bool LinearPhaseEq::runQueuedTailJob()
+{
+    auto expected = (int)tailJobQueued;
+
+    if (! tailJobState.compare_exchange_strong(expected, tailJobRunning, std::memory_order_acquire))
+        return false;
+
+    runTailJob();
+    tailJobState.store(tailJobIdle, std::memory_order_release);
+    return true;
+}
+
+void LinearPhaseEq::runTailJob()
+{
+    tailRingHead = (tailRingHead == 0 ? numTailPartitions : tailRingHead) - 1;
+
+    for (int channel = 0; channel < tailJobChannels; ++channel)
+    {
+        auto& state = channels[(size_t)channel];
+        const auto* input = state.tailInput.data() + tailJobHalf * tailSize;
+        auto* output = state.tailOutput.data() + tailJobHalf * tailSize;
+
+        // Overlap-save again, a block of T at a time.
+        auto& history = state.tailHistory;
+        std::copy(history.begin() + tailSize, history.end(), history.begin());
+        std::copy(input, input + tailSize, history.begin() + tailSize);
+
+        std::copy(history.begin(), history.end(), tailFftBuffer.begin());
+        std::fill(tailFftBuffer.begin() + 2 * tailSize, tailFftBuffer.end(), 0.0f);
+        tailFft->performRealOnlyForwardTransform(tailFftBuffer.data(), true);
+
+        splitBins(tailFftBuffer.data(),
+                  state.tailInputReal.data() + tailRingHead * paddedTailBins,
+                  state.tailInputImag.data() + tailRingHead * paddedTailBins,
+                  numTailBins);
+
+        if (!tailJobHeard)
+            continue;
+
+        convolveTail(*tailJobKernel, state, output);
+
+        // The same ramp over the same samples as the head's fade.
+        if (tailJobFadeFrom != nullptr)
+        {
+            convolveTail(*tailJobFadeFrom, state, tailFadeOutput.data());
+
+            for (int i = 0; i < partitionSize; ++i)
+            {
+                const auto t = (float)(i + 1) / (float)partitionSize;
+                output[i] = tailFadeOutput[(size_t)i] + (output[i] - tailFadeOutput[(size_t)i]) * t;
+            }
+        }
+    }
+}
+
+void LinearPhaseEq::convolveTail(const FirPartitionSpectra& kernel, ChannelState& state, float* destination)
+{
+    multiplyAccumulatePartitions(*dsp, tailAccReal.data(), tailAccImag.data(),
+                                 state.tailInputReal.data(), state.tailInputImag.data(), tailRingHead,
+                                 kernel.tailReal.data(), kernel.tailImag.data(), numTailPartitions, paddedTailBins);
+
+    interleaveBins(tailAccReal.data(), tailAccImag.data(), tailFftBuffer.data(), numTailBins);
+    tailFft->performRealOnlyInverseTransform(tailFftBuffer.data());
+
+    std::copy(tailFftBuffer.begin() + tailSize, tailFftBuffer.begin() + 2 * tailSize, destination);
+}
+
+void LinearPhaseEq::stopTailThread()
+{
+    if (tailThread != nullptr)
+    {
+        tailThread->signalThreadShouldExit();
+        tailThread->notify();
+        tailThread->stopThread(1000);
+        tailThread.reset();
+    }
+
+    tailJobState.store(tailJobIdle);
+}
+
+void LinearPhaseEq::TailThread::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        if (threadShouldExit())
+            return;
+
+        owner.runQueuedTailJob();
+    }
+}
+
+int LinearPhaseEq::useTimeSlice()
+{
+    const juce::ScopedLock sl(designLock);
+
+    if (coefficientMailbox.acquire())
+        kernelOutOfDate = true;
+
+    if (kernelOutOfDate && enabled.load(std::memory_order_relaxed))
+        kernelOutOfDate = !designKernel(coefficientMailbox.getReadBuffer());
+
+    return pollIntervalMs;
+}
+
+bool LinearPhaseEq::designKernel(const FilterCoefficientSet& coefficients)
+{
+    if (firLength == 0 || coefficients.sampleRate <= 0.0)
+        return false;
+
+    // The coefficients may be designed at an oversampled rate, which only
+    // moves where the FIR's bins fall on their unit circle.
+    if (! juce::exactlyEqual(coefficients.sampleRate, curveRate))
+    {
+        curveRate = coefficients.sampleRate;
+
+        for (int k = 0; k <= firLength / 2; ++k)
+        {
+            const auto w = juce::MathConstants<double>::twoPi * k * preparedRate / (firLength * curveRate);
+            cosW[(size_t)k] = std::cos(w);
+            cos2W[(size_t)k] = std::cos(2.0 * w);
+        }
+    }
+
+    // |H| of the whole cascade at every bin of the FIR's FFT, with no phase.
+    const auto packed = packCascadeSections(coefficients);
+    MagnitudeResponseSection sections[maxCascadeSections];
+
+    for (int i = 0; i < packed.numSections; ++i)
+        sections[i] = makeMagnitudeResponseSection(packed.sections[i].coefficients);
+
+    getDspKernels().evaluateMagnitudeSquared(sections, packed.numSections, cosW.data(), cos2W.data(),
+                                             magnitudes.data(), (int)magnitudes.size());
+
+    std::fill(taps.begin(), taps.end(), 0.0f);
+
+    // Rounding can take a zero of the low or high cut just below 0.
+    for (int k = 0; k <= firLength / 2; ++k)
+        taps[(size_t)(2 * k)] = (float)std::sqrt(juce::jmax(0.0, magnitudes[(size_t)k]));
+
+    firFft->performRealOnlyInverseTransform(taps.data());
+
+    // That impulse is symmetric about 0; centred on firLength / 2 and windowed
+    // it is a causal FIR that is still symmetric, and so linear phase.
+    // Until the audio thread gives one back, this waits for the next poll.
+    auto* slot = kernels->beginWrite();
+
+    if (slot == nullptr)
+        return false;
+
+    const auto windowedTap = [this](int tap)
+    {
+        return taps[(size_t)((tap + firLength / 2) & (firLength - 1))] * window[(size_t)tap];
+    };
+
+    auto& kernel = *slot;
+    kernel.real.assign((size_t)(numPartitions * paddedBins), 0.0f);
+    kernel.imag.assign((size_t)(numPartitions * paddedBins), 0.0f);
+    kernel.tailReal.assign((size_t)(numTailPartitions * paddedTailBins), 0.0f);
+    kernel.tailImag.assign((size_t)(numTailPartitions * paddedTailBins), 0.0f);
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        std::fill(designBuffer.begin(), designBuffer.end(), 0.0f);
+
+        for (int n = 0; n < partitionSize; ++n)
+            designBuffer[(size_t)n] = windowedTap(p * partitionSize + n);
+
+        designPartitionFft->performRealOnlyForwardTransform(designBuffer.data(), true);
+        splitBins(designBuffer.data(), kernel.real.data() + p * paddedBins, kernel.imag.data() + p * paddedBins, numBins);
+    }
+
+    // The tail picks up where the head's 2T taps leave off.
+    for (int p = 0; p < numTailPartitions; ++p)
+    {
+        std::fill(designTailBuffer.begin(), designTailBuffer.end(), 0.0f);
+
+        for (int n = 0; n < tailSize; ++n)
+            designTailBuffer[(size_t)n] = windowedTap((p + 2) * tailSize + n);
+
+        designTailFft->performRealOnlyForwardTransform(designTailBuffer.data(), true);
+        splitBins(designTailBuffer.data(), kernel.tailReal.data() + p * paddedTailBins,
+                  kernel.tailImag.data() + p * paddedTailBins, numTailBins);
+    }
+
+    kernels->finishWrite();
+    return true;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include "DspKernels.h"
+#include "Fifo.h"
+#include "FilterDesign.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ A FIR cut into partitions, each zero-padded to twice its length and
+ transformed, with the real and imaginary parts of every spectrum kept apart
+ for the spectrum kernels: the head in partitions of B taps, and whatever is
+ left in partitions of T.
+ */
+struct FirPartitionSpectra
+{
+    std::vector<float> real, imag, tailReal, tailImag;
+};
+
+/**
+ The EQ as a linear-phase FIR, run by partitioned overlap-save convolution in
+ two sizes.
+
+ A thread shared by every instance turns each coefficient set the designer
+ publishes into a FIR with the same magnitude response and no phase shift
+ besides its delay: |H| sampled on an FFT grid, transformed back, centred and
+ windowed. The taps are cut into partitions and each is transformed there
+ too, so the other threads only ever see finished spectra.
+
+ The first 2T taps are P partitions of B samples, where B is the host block
+ size rounded up to a power of two and T is eight times that. Every B samples
+ of input get transformed once into a ring of the last P input spectra, and
+ the output is their products with the kernel's spectra summed and
+ transformed back: one forward and one inverse FFT of 2B and a P (B + 1) bin
+ multiply-accumulate, so a block does at most one partition's work, and that
+ work depends on B alone, not on how long the FIR is.
+
+ The rest of the FIR, which is what grows with the sample rate, is cut into
+ partitions of T and run the same way every T samples by a thread of each
+ instance's own. Those taps start 2T in, so each block of T input samples
+ only reaches the output a whole block after it has arrived, and the thread
+ has that long to finish. If it hasn't by then, the audio thread does the job
+ itself, or waits out the rest if the thread is part way through.
+
+ A new kernel fades in over one partition of B. Both kernels read the same
+ input spectra, so the fade costs a second multiply-accumulate and inverse
+ FFT and nothing else. The tail can only change kernels at a block of T, so
+ when there is one a new kernel waits for the next such block, and the tail
+ thread fades over the same B samples.
+
+ Channels share nothing but the kernel, so given a TaskRunner each one's
+ partition can run on a thread of its own. Nothing allocates once prepared.
+
+ The latency is B for the partition buffering plus half the FIR.
+ */
+class LinearPhaseEq : private juce::TimeSliceClient
+{
+public:
+    explicit LinearPhaseEq(TripleBuffer<FilterCoefficientSet>& coefficientMailbox);
+    ~LinearPhaseEq() override;
+
+    /** Sizes everything for the rate and block size, and designs the first kernel before returning. */
+    void prepare(double sampleRate, int numChannels, int maximumBlockSize);
+    void reset();
+
+    /**
+     Like reset(), but the numSamples of input just before the next process()
+     come through prime() first, so the output starts as if it had been
+     running all along rather than from silence.
+     */
+    void startPriming(int numSamples);
+
+    /** Kernels are only designed while enabled, so the mode costs nothing when it's off. */
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+
+    /** Spreads channels over runner's threads, or keeps them on the calling one with nullptr; the output is the same. */
+    void setTaskRunner(TaskRunner* runner) { taskRunner = runner; }
+
+    /** For float or double hosts; the convolution itself runs in float either way. */
+    template<typename SampleType>
+    void process(SampleType* const* channels, int numChannels, int numSamples);
+
+    /** Input for startPriming(), oldest first. Only what will still be heard gets convolved; the rest is just transformed into the history. */
+    template<typename SampleType>
+    void prime(const SampleType* const* channels, int numChannels, int numSamples);
+
+    int getLatencySamples() const { return latencySamples; }
+
+    /** How long after the input stops the output does: the latency plus the second half of the FIR. */
+    int getTailSamples() const { return latencySamples + firLength / 2; }
+private:
+    struct DesignThread : juce::TimeSliceThread
+    {
+        DesignThread() : juce::TimeSliceThread("PSPVST Linear Phase Designer") { startThread(); }
+        ~DesignThread() override { stopThread(1000); }
+    };
+
+    struct TailThread : juce::Thread
+    {
+        explicit TailThread(LinearPhaseEq& eq) : juce::Thread("PSPVST Linear Phase Tail"), owner(eq) {}
+        void run() override;
+
+        LinearPhaseEq& owner;
+    };
+
+    struct ChannelState
+    {
+        // The last 2B input samples, and the B output samples being played out.
+        std::vector<float> input, output;
+
+        // P spectra of 2B inputs each, newest at ringHead.
+        std::vector<float> inputReal, inputImag;
+
+        // Scratch, and a transform of its own, so channels can run at once.
+        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<float> fftBuffer, accReal, accImag, fadeOutput;
+
+        // Two blocks of T, one being gathered on the audio thread while the
+        // tail thread works on the other, for both input and output.
+        std::vector<float> tailInput, tailOutput;
+
+        // The last 2T input samples and the spectra of the input's blocks of T, newest at tailRingHead.
+        std::vector<float> tailHistory, tailInputReal, tailInputImag;
+    };
+
+    // Long enough to resolve the low cut, rounded up to a power of two: 8192 taps at 44.1 or 48 kHz.
+    static constexpr double minimumFirSeconds = 0.15;
+    static constexpr int minPartitionSize = 64;
+    static constexpr int tailPartitionRatio = 8;
+    static constexpr int pollIntervalMs = 4;
+
+    TripleBuffer<FilterCoefficientSet>& coefficientMailbox;
+
+    // Sizes, set by prepare().
+    double preparedRate = 0.0;
+    int firLength = 0, partitionSize = 0, numPartitions = 0, numBins = 0, paddedBins = 0;
+    int tailSize = 0, numTailPartitions = 0, numTailBins = 0, paddedTailBins = 0;
+    int latencySamples = 0;
+
+    // Design thread. prepare() takes the lock too, since it resizes all of this.
+    juce::CriticalSection designLock;
+    std::atomic<bool> enabled{ false };
+    bool kernelOutOfDate = true;
+    std::unique_ptr<juce::dsp::FFT> firFft, designPartitionFft, designTailFft;
+    std::vector<double> cosW, cos2W, magnitudes;
+    double curveRate = 0.0;
+    std::vector<float> window, taps, designBuffer, designTailBuffer;
+
+    // Filled in place by the design thread and lent to the audio thread, which
+    // keeps the one it is playing and gives it back once it has faded out.
+    static constexpr int numKernelSlots = 3;
+    std::unique_ptr<Fifo<FirPartitionSpectra, numKernelSlots>> kernels;
+
+    // Audio thread. A new kernel waits partitionsUntilSwitch partitions for
+    // the tail to catch up, and then the older slots go back.
+    const DspKernels* dsp = nullptr;
+    FirPartitionSpectra* currentKernel = nullptr;
+    FirPartitionSpectra* nextKernel = nullptr;
+    int partitionsUntilSwitch = 0, kernelsToRelease = 0;
+    std::vector<ChannelState> channels;
+    int ringHead = 0, position = 0, tailPosition = 0, tailHalf = 0;
+    bool fading = false;
+
+    // While priming, how much input is still to come, and whether this partition's output will be heard.
+    bool priming = false;
+    int primingSamples = 0;
+    bool partitionHeard = true;
+    TaskRunner* taskRunner = nullptr;
+
+    // The tail job, written by the audio thread before it is queued and then
+    // run by whichever thread takes it from queued to running first.
+    enum { tailJobIdle, tailJobQueued, tailJobRunning };
+    std::atomic<int> tailJobState{ tailJobIdle };
+    const FirPartitionSpectra* tailJobKernel = nullptr;
+    const FirPartitionSpectra* tailJobFadeFrom = nullptr;
+    int tailJobHalf = 0, tailJobChannels = 0;
+    bool tailJobHeard = true;
+
+    // Whoever runs the tail job.
+    std::unique_ptr<juce::dsp::FFT> tailFft;
+    std::vector<float> tailFftBuffer, tailAccReal, tailAccImag, tailFadeOutput;
+    int tailRingHead = 0;
+    std::unique_ptr<TailThread> tailThread;
+
+    juce::SharedResourcePointer<DesignThread> designThread;
+
+    int useTimeSlice() override;
+    bool designKernel(const FilterCoefficientSet& coefficients);
+
+    void processPartition(int numChannels);
+    void processChannelPartition(ChannelState& state);
+    void convolve(const FirPartitionSpectra& kernel, ChannelState& state, float* destination);
+
+    void queueTailJob(int numChannels);
+    void finishTailJob();
+    bool runQueuedTailJob();
+    void runTailJob();
+    void convolveTail(const FirPartitionSpectra& kernel, ChannelState& state, float* destination);
+    void stopTailThread();
+
+    JUCE_DECLARE_NON_COPYABLE(LinearPhaseEq)
+};
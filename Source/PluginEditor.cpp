@@ -3,19 +3,19 @@
 
 
 ResponseCurveComponent::ResponseCurveComponent(AudioPluginAudioProcessor& p) : processorRef(p),
-leftPathProducer(processorRef.leftChannelFifo),
-rightPathProducer(processorRef.rightChannelFifo)
+leftPathProducer(processorRef.leftChannelSamples),
+rightPathProducer(processorRef.rightChannelSamples)
 {
-    for (auto* param : processorRef.getParameters())
-        param->addListener(this);
+    analyzerSampleRate.store(processorRef.getSampleRate(), std::memory_order_relaxed);
+    analyzerThread->addTimeSliceClient(this);
 
-    startTimerHz(60);
+    startTimerHz(framesPerSecond);
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
-    for (auto* param : processorRef.getParameters())
-        param->removeListener(this);
+    // Waits for a frame in progress, so the producers outlive it.
+    analyzerThread->removeTimeSliceClient(this);
 }
 
 void ResponseCurveComponent::updateResponseCurve()
@@ -25,49 +25,42 @@ void ResponseCurveComponent::updateResponseCurve()
     auto responseArea = getAnalysisArea();
     auto w = responseArea.getWidth();
 
-    auto& lowcut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highcut = monoChain.get<ChainPositions::HighCut>();
+    // The same snapshot the audio thread is filtering with, so the curve never
+    // disagrees with what you hear.
+    auto& coefficients = processorRef.coefficientDesigner.getEditorMailbox().getReadBuffer();
 
-    auto sampleRate = processorRef.getSampleRate();
+    // Evaluate every pixel at once: each section's |H|^2 only depends on
+    // cos(w) and cos(2w), so those are worked out per pixel up front and the
+    // kernel runs the sections across a register's worth of pixels at a time.
+    const auto numPoints = (w + dspKernelPadding - 1) / dspKernelPadding * dspKernelPadding;
 
-    std::vector<double> mags(w);
+    std::vector<double> cosW((size_t)numPoints, 1.0), cos2W((size_t)numPoints, 1.0), mags((size_t)numPoints, 1.0);
 
-    for (int i = 0; i < w; ++i)
-    {
-        double mag = 1.f;
-        auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
-
-        if (!monoChain.isBypassed<ChainPositions::Peak>())
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-        if (!monoChain.isBypassed<ChainPositions::LowCut>())
-        {
-            if (!lowcut.isBypassed<0>())
-                mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<1>())
-                mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<2>())
-                mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<3>())
-                mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
+    MagnitudeResponseSection sections[maxCascadeSections];
+    int numSections = 0;
 
-        if (!monoChain.isBypassed<ChainPositions::HighCut>())
+    if (coefficients.sampleRate > 0.0)
+    {
+        for (int i = 0; i < w; ++i)
         {
-            if (!highcut.isBypassed<0>())
-                mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<1>())
-                mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<2>())
-                mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<3>())
-                mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
+            auto omega = MathConstants<double>::twoPi * freq / coefficients.sampleRate;
+            cosW[(size_t)i] = std::cos(omega);
+            cos2W[(size_t)i] = std::cos(2.0 * omega);
         }
 
-        mags[i] = Decibels::gainToDecibels(mag);
+        auto packed = packCascadeSections(coefficients);
+        for (numSections = 0; numSections < packed.numSections; ++numSections)
+            sections[numSections] = makeMagnitudeResponseSection(packed.sections[numSections].coefficients);
     }
 
+    getDspKernels().evaluateMagnitudeSquared(sections, numSections, cosW.data(), cos2W.data(), mags.data(), numPoints);
+
+    mags.resize((size_t)w);
+
+    for (auto& mag : mags)
+        mag = Decibels::gainToDecibels(std::sqrt(mag));
+
     responseCurve.clear();
 
     const double outputMin = responseArea.getBottom();
@@ -102,17 +95,14 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 
     if (shouldShowFFTAnalysis)
     {
-        auto leftChannelFFTPath = leftPathProducer.getPath();
-        leftChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+        // Stroked where they are, moved into place by the transform rather than copied.
+        auto toResponseArea = AffineTransform::translation((float)responseArea.getX(), (float)responseArea.getY());
 
         g.setColour(Colour(120, 180, 255)); 
-        g.strokePath(leftChannelFFTPath, PathStrokeType(1.5f));
-
-        auto rightChannelFFTPath = rightPathProducer.getPath();
-        rightChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+        g.strokePath(leftPathProducer.getPath(), PathStrokeType(1.5f), toResponseArea);
 
         g.setColour(Colour(160, 255, 200));
-        g.strokePath(rightChannelFFTPath, PathStrokeType(1.f));
+        g.strokePath(rightPathProducer.getPath(), PathStrokeType(1.f), toResponseArea);
     }
 
     g.setColour(Colours::white);
@@ -283,95 +273,127 @@ void ResponseCurveComponent::resized()
 
     responseCurve.preallocateSpace(getWidth() * 3);
     updateResponseCurve();
-}
 
-
-void ResponseCurveComponent::parameterValueChanged(int, float)
-{
-    parametersChanged.set(true);
+    auto fftBounds = getAnalysisArea().toFloat();
+    leftPathProducer.setBounds(fftBounds);
+    rightPathProducer.setBounds(fftBounds);
 }
 
-void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
+
+void PathProducer::process(double sampleRate)
 {
-    juce::AudioBuffer<float> tempIncomingBuffer;
-    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
-    {
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer))
-        {
-            auto size = tempIncomingBuffer.getNumSamples();
+    const auto length = monoBuffer.getNumSamples();
+    const auto ready = samples->getNumReady();
+    const auto maxLag = juce::roundToInt(sampleRate * maxLagSeconds);
 
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
-                                              monoBuffer.getReadPointer(0, size),
-                                              monoBuffer.getNumSamples() - size);
+    auto numHops = ready >= hopSize ? 1 : 0;
 
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                                              tempIncomingBuffer.getReadPointer(0, 0),
-                                              size);
+    // Enough hops to get back within maxLag, but never more than have arrived.
+    if (ready - hopSize > maxLag)
+        numHops = juce::jmin((ready - maxLag + hopSize - 1) / hopSize, ready / hopSize);
 
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
-        }
-    }
+    if (numHops == 0)
+        return;
 
-    const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
-    const auto binWidth = sampleRate / double(fftSize);
+    // Only the newest monoBuffer's worth matters; anything older than
+    // that is dropped without being read.
+    auto numNew = numHops * hopSize;
 
-    while (leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0)
+    if (numNew > length)
     {
-        std::vector<float> fftData;
-        if (leftChannelFFTDataGenerator.getFFTData(fftData))
-        {
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
-        }
+        samples->discard(numNew - length);
+        numNew = length;
     }
 
-    while (pathProducer.getNumPathsAvailable() > 0)
+    juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
+                                      monoBuffer.getReadPointer(0, numNew),
+                                      length - numNew);
+
+    // Nothing else reads the ring and numNew is no more than was ready, so
+    // this always gets the lot; if it ever didn't, the window would have a
+    // stale gap in it, so it isn't drawn.
+    if (samples->pull(monoBuffer.getWritePointer(0, length - numNew), numNew) != numNew)
     {
-        pathProducer.getPath(leftChannelFFTPath);
+        jassertfalse;
+        return;
     }
+
+    leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
+
+    const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
+    const auto binWidth = sampleRate / double(fftSize);
+
+    juce::Rectangle<float> fftBounds(0.f,
+                                     boundsY.load(std::memory_order_relaxed),
+                                     boundsWidth.load(std::memory_order_relaxed),
+                                     boundsHeight.load(std::memory_order_relaxed));
+
+    // Every hop jumped is a frame never drawn, and so is this one if the
+    // message thread is holding every slot.
+    auto skipped = numHops - 1;
+
+    if (!pathProducer.generatePath(leftChannelFFTDataGenerator.getFFTData(), fftBounds, fftSize, binWidth, -48.f))
+        ++skipped;
+
+    skippedFrames.fetch_add(skipped, std::memory_order_relaxed);
 }
 
 void ResponseCurveComponent::timerCallback()
 {
+        // The rest happens on the analyzer thread; this only picks up what it finished.
+        analyzerSampleRate.store(processorRef.getSampleRate(), std::memory_order_relaxed);
+
         if (shouldShowFFTAnalysis)
         {
-            auto fftBounds = getAnalysisArea().toFloat();
-            auto sampleRate = processorRef.getSampleRate();
-
-            leftPathProducer.process(fftBounds, sampleRate);
-            rightPathProducer.process(fftBounds, sampleRate);
+            leftPathProducer.acquirePath();
+            rightPathProducer.acquirePath();
         }
 
-        if (parametersChanged.compareAndSetBool(false, true))
-        {
-            updateChain();
+        if (processorRef.coefficientDesigner.getEditorMailbox().acquire())
             updateResponseCurve();
-        }
 
 
         repaint();
     }
 
-void ResponseCurveComponent::updateChain()
+int ResponseCurveComponent::useTimeSlice()
 {
-    auto chainSettings = getChainSettings(processorRef.apvts);
+    const auto now = juce::Time::getMillisecondCounter();
+    const auto untilNextFrame = (int)(nextAnalyzerFrame - now);
+
+    if (untilNextFrame > 0)
+        return untilNextFrame;
 
-    monoChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    monoChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    monoChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    // A frame every analyzerFrameIntervalMs, on a schedule of its own so the
+    // time spent here doesn't slow it down. Falling more than a frame behind
+    // starts again from now instead of catching up in a burst.
+    nextAnalyzerFrame = (untilNextFrame < -analyzerFrameIntervalMs ? now : nextAnalyzerFrame) + analyzerFrameIntervalMs;
 
-    auto peakCoefficients = makePeakFilter(chainSettings, processorRef.getSampleRate());
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    const auto sampleRate = analyzerSampleRate.load(std::memory_order_relaxed);
 
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, processorRef.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, processorRef.getSampleRate());
+    if (shouldShowFFTAnalysis && sampleRate > 0.0)
+    {
+        const auto order = (FFTOrder)(minFFTOrder + juce::jlimit(0, numFFTOrders - 1, juce::roundToInt(analyzerResolution->load())));
+        const auto overlap = juce::jlimit(0, 3, juce::roundToInt(analyzerOverlap->load()));
+
+        // By default one FFT per channel per frame, at any sample rate or block
+        // size. Only one frame is drawn per display frame, so an overlap whose
+        // hop is shorter than that is held to it rather than falling behind.
+        const auto frameHopSize = juce::roundToInt(sampleRate * analyzerFrameIntervalMs / 1000.0);
+        const auto hopSize = overlap == 0 ? frameHopSize
+                                          : juce::jmax(frameHopSize, (1 << order) >> overlap);
+
+        leftPathProducer.setOrder(order);
+        rightPathProducer.setOrder(order);
 
-    updateCutFilter(monoChain.get<ChainPositions::LowCut>(),
-                    lowCutCoefficients,
-                    chainSettings.lowCutSlope);
+        leftPathProducer.setHopSize(hopSize);
+        rightPathProducer.setHopSize(hopSize);
+
+        leftPathProducer.process(sampleRate);
+        rightPathProducer.process(sampleRate);
+    }
 
-    updateCutFilter(monoChain.get<ChainPositions::HighCut>(),
-                    highCutCoefficients,
-                    chainSettings.highCutSlope);
+    return juce::jmax(1, (int)(nextAnalyzerFrame - juce::Time::getMillisecondCounter()));
 }
 
 juce::Rectangle<int> ResponseCurveComponent::getRenderArea()
@@ -1,4 +1,5 @@
 #pragma once
+#include "Fifo.h"
 #include "PluginProcessor.h"
 
 enum FFTOrder
@@ -8,91 +9,98 @@ enum FFTOrder
     order8192 = 13
 };
 
+constexpr FFTOrder minFFTOrder = order2048, maxFFTOrder = order8192;
+constexpr int numFFTOrders = maxFFTOrder - minFFTOrder + 1;
+constexpr int maxFFTSize = 1 << maxFFTOrder;
+
+/**
+ Analyzer frames at any FFTOrder. The plan and window for every order, and
+ room in each frame for the largest, are all built up front, so changing
+ order just picks a different set and takes effect on the next frame
+ without allocating anything.
+ */
 template<typename BlockType>
 struct FFTDataGenerator
 {
+    FFTDataGenerator()
+    {
+        for (int i = 0; i < numFFTOrders; ++i)
+        {
+            const auto fftSize = 1 << (minFFTOrder + i);
+
+            forwardFFTs[i] = std::make_unique<juce::dsp::FFT>(minFFTOrder + i);
+            windowTables[i].assign((size_t)fftSize, 0);
+            juce::dsp::WindowingFunction<float>::fillWindowingTables(windowTables[i].data(), (size_t)fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        }
+    }
+
     /**
-     produces the FFT data from an audio buffer.
+     produces the FFT data from the newest getFFTSize() samples of an audio
+     buffer, in place, for getFFTData() to read until the next call.
      */
     void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
     {
+        auto* fftData = &fftDataBuffer;
+
         const auto fftSize = getFFTSize();
+        const auto index = order - minFFTOrder;
+
+        jassert(audioData.getNumSamples() >= fftSize);
 
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
+        auto* readIndex = audioData.getReadPointer(0, audioData.getNumSamples() - fftSize);
+        std::copy(readIndex, readIndex + fftSize, fftData->begin());
+        std::fill(fftData->begin() + fftSize, fftData->end(), 0.f);
+
+        const auto& kernels = getDspKernels();
 
         // first apply a windowing function to our data
-        window->multiplyWithWindowingTable(fftData.data(), fftSize);       // [1]
+        kernels.applyWindow(fftData->data(), windowTables[index].data(), fftSize);  // [1]
 
         // then render our FFT data..
-        forwardFFT->performFrequencyOnlyForwardTransform(fftData.data());  // [2]
+        forwardFFTs[index]->performFrequencyOnlyForwardTransform(fftData->data());  // [2]
 
         int numBins = (int)fftSize / 2;
 
-        //normalize the fft values.
-        for (int i = 0; i < numBins; ++i)
-        {
-            auto v = fftData[i];
-            //            fftData[i] /= (float) numBins;
-            if (!std::isinf(v) && !std::isnan(v))
-            {
-                v /= float(numBins);
-            }
-            else
-            {
-                v = 0.f;
-            }
-            fftData[i] = v;
-        }
-
-        //convert them to decibels
-        for (int i = 0; i < numBins; ++i)
-        {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
-        }
-
-        fftDataFifo.push(fftData);
+        //normalize the fft values and convert them to decibels, treating
+        //inf and nan as silence.
+        kernels.magnitudesToDecibels(fftData->data(), numBins, 1.f / float(numBins), negativeInfinity);
     }
 
+    /** Takes effect from the next frame produced. */
     void changeOrder(FFTOrder newOrder)
     {
-        //when you change order, recreate the window, forwardFFT, fifo, fftData
-        //also reset the fifoIndex
-        //things that need recreating should be created on the heap via std::make_unique<>
-
+        jassert(newOrder >= minFFTOrder && newOrder <= maxFFTOrder);
         order = newOrder;
-        auto fftSize = getFFTSize();
-
-        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
-
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
-
-        fftDataFifo.prepare(fftData.size());
     }
     //==============================================================================
     int getFFTSize() const { return 1 << order; }
-    int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
     //==============================================================================
-    bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
+    /** The frame most recently produced; the path stage draws straight from it on the same thread. */
+    const BlockType& getFFTData() const { return fftDataBuffer; }
 private:
-    FFTOrder order;
-    BlockType fftData;
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+    FFTOrder order = minFFTOrder;
+    std::unique_ptr<juce::dsp::FFT> forwardFFTs[numFFTOrders];
+    std::vector<float> windowTables[numFFTOrders];
 
-    Fifo<BlockType> fftDataFifo;
+    BlockType fftDataBuffer = BlockType((size_t)maxFFTSize * 2, 0.f);
 };
 
 template<typename PathType>
 struct AnalyzerPathGenerator
 {
+    AnalyzerPathGenerator()
+    {
+        // The reader starts out holding an empty path, so there is always one to draw.
+        pathFifo.beginWrite();
+        pathFifo.finishWrite();
+        currentPath = pathFifo.beginRead();
+    }
+
     /*
-     converts 'renderData[]' into a juce::Path
+     converts 'renderData[]' into a juce::Path and hands it to the reader,
+     returning false if the reader was too far behind to leave a slot for it.
      */
-    void generatePath(const std::vector<float>& renderData,
+    bool generatePath(const std::vector<float>& renderData,
                       juce::Rectangle<float> fftBounds,
                       int fftSize,
                       float binWidth,
@@ -104,7 +112,15 @@ struct AnalyzerPathGenerator
 
         int numBins = (int)fftSize / 2;
 
-        PathType p;
+        // Built in place in the fifo's next free slot, reusing whatever space
+        // the path that was last there had.
+        auto* slot = pathFifo.beginWrite();
+
+        if (slot == nullptr)
+            return false;
+
+        auto& p = *slot;
+        p.clear();
         p.preallocateSpace(3 * (int)fftBounds.getWidth());
 
         auto map = [bottom, top, negativeInfinity](float v)
@@ -116,7 +132,6 @@ struct AnalyzerPathGenerator
 
         auto y = map(renderData[0]);
 
-        //        jassert( !std::isnan(y) && !std::isinf(y) );
         if (std::isnan(y) || std::isinf(y))
             y = bottom;
 
@@ -128,8 +143,6 @@ struct AnalyzerPathGenerator
         {
             y = map(renderData[binNum]);
 
-            //            jassert( !std::isnan(y) && !std::isinf(y) );
-
             if (!std::isnan(y) && !std::isinf(y))
             {
                 auto binFreq = binNum * binWidth;
@@ -139,42 +152,107 @@ struct AnalyzerPathGenerator
             }
         }
 
-        pathFifo.push(p);
+        pathFifo.finishWrite();
+        return true;
     }
 
-    int getNumPathsAvailable() const
+    /**
+     Reader only. Moves on to the newest path, giving the one it held, and
+     any that came in before the newest, back to be drawn into again. Returns
+     how many arrived since the last call; all but the newest are never drawn.
+     */
+    int acquirePath()
     {
-        return pathFifo.getNumAvailableForReading();
-    }
+        const auto numReady = pathFifo.getNumReady();
 
-    bool getPath(PathType& path)
-    {
-        return pathFifo.pull(path);
+        if (numReady < 2)
+            return 0;
+
+        pathFifo.finishRead(numReady - 1);
+        currentPath = pathFifo.beginRead();
+        return numReady - 1;
     }
+
+    /** Reader only. The path most recently acquired. */
+    const PathType& getPath() const { return *currentPath; }
 private:
-    Fifo<PathType> pathFifo;
+    // One slot is always the reader's, and the rest leave room for a few
+    // frames while the reader is busy. Past that, new frames are dropped
+    // until it catches up, rather than drawn for nobody.
+    static constexpr int numPathSlots = 4;
+
+    Fifo<PathType, numPathSlots> pathFifo;
+    PathType* currentPath = nullptr;
 };
 
 struct PathProducer
 {
-    PathProducer(SingleChannelSampleFifo<AudioPluginAudioProcessor::BlockType>& scsf) :
-        leftChannelFifo(&scsf)
+    PathProducer(SampleRing& ring) :
+        samples(&ring)
     {
-        leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
-        monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+        // Always the largest order's worth, so a switch up has its history ready.
+        monoBuffer.setSize(1, maxFFTSize);
     }
-    void process(juce::Rectangle<float> fftBounds, double sampleRate);
-    juce::Path getPath() { return leftChannelFFTPath; }
+    /**
+     Analyzer thread. Moves the analysis window on by one hop, if that much
+     has arrived, and transforms and draws it. However the host's blocks are
+     sized, that is one FFT per call at most, and frames keep an even pace as
+     long as a hop is about what arrives between calls.
+
+     If it falls more than maxLagSeconds behind, it jumps the extra hops and
+     only draws the newest, so after a stall there is one frame's work to do.
+     */
+    void process(double sampleRate);
+
+    /** Analyzer thread. The resolution of the next frame, with no gap or glitch in between. */
+    void setOrder(FFTOrder order) { leftChannelFFTDataGenerator.changeOrder(order); }
+
+    /** Analyzer thread. How far the window moves between frames, in samples. */
+    void setHopSize(int samples) { hopSize = juce::jmax(1, samples); }
+    int getHopSize() const { return hopSize; }
+
+    /** Message thread. Where the paths are drawn, picked up by the next process(). */
+    void setBounds(juce::Rectangle<float> bounds)
+    {
+        boundsY.store(bounds.getY(), std::memory_order_relaxed);
+        boundsWidth.store(bounds.getWidth(), std::memory_order_relaxed);
+        boundsHeight.store(bounds.getHeight(), std::memory_order_relaxed);
+    }
+
+    /** Message thread. Swaps in the newest finished path, returning false if there isn't one. */
+    bool acquirePath()
+    {
+        const auto numArrived = pathProducer.acquirePath();
+
+        if (numArrived > 1)
+            skippedFrames.fetch_add(numArrived - 1, std::memory_order_relaxed);
+
+        return numArrived > 0;
+    }
+
+    /** Message thread. The path most recently acquired. */
+    const juce::Path& getPath() const { return pathProducer.getPath(); }
+
+    /**
+     Frames that were due but never drawn: hops jumped to catch up after a
+     stall, frames with no slot to be drawn into, and paths passed over for
+     a newer one when the message thread picked them up.
+     */
+    int getNumSkippedFrames() const { return skippedFrames.load(std::memory_order_relaxed); }
 private:
-    SingleChannelSampleFifo<AudioPluginAudioProcessor::BlockType>* leftChannelFifo;
+    // Enough to smooth over blocks of 4096 at 48 kHz arriving all at once.
+    static constexpr double maxLagSeconds = 0.1;
+
+    SampleRing* samples;
+    int hopSize = 1024;
+    std::atomic<int> skippedFrames{ 0 };
+    std::atomic<float> boundsY{ 0.f }, boundsWidth{ 0.f }, boundsHeight{ 0.f };
 
     juce::AudioBuffer<float> monoBuffer;
 
     FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
 
     AnalyzerPathGenerator<juce::Path> pathProducer;
-
-    juce::Path leftChannelFFTPath;
 };
 
 class SplashScreenComponent : public juce::Component, private juce::Timer
@@ -222,14 +300,19 @@ private:
 };
 
 
+/**
+ The response curve, with the spectrum of both channels behind it.
+
+ The analyzers run on a low-priority thread shared by every open editor in
+ the process, a frame at a time; the timer only picks up finished paths and
+ repaints, so the message thread does no FFTs however many editors are open.
+ */
 struct ResponseCurveComponent: juce::Component,
-	juce::AudioProcessorParameter::Listener,
-	juce::Timer
+	juce::Timer,
+    private juce::TimeSliceClient
 {
     ResponseCurveComponent(AudioPluginAudioProcessor&);
     ~ResponseCurveComponent() override;
-    void parameterValueChanged(int parameterIndex, float newValue) override;
-    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override {}
     void paint(juce::Graphics&) override;
 
     void resized() override;
@@ -244,21 +327,42 @@ struct ResponseCurveComponent: juce::Component,
         shouldShowFFTAnalysis = enabled;
     }
 
+    /** Analyzer frames dropped for newer ones across both channels, for diagnostics. */
+    int getNumSkippedAnalyzerFrames() const
+    {
+        return leftPathProducer.getNumSkippedFrames() + rightPathProducer.getNumSkippedFrames();
+    }
+
 private:
     AudioPluginAudioProcessor& processorRef;
 
-    bool shouldShowFFTAnalysis = true;
+    // An index into the FFTOrders from minFFTOrder up, read afresh every frame.
+    std::atomic<float>* analyzerResolution = processorRef.apvts.getRawParameterValue("Analyzer Resolution");
+
+    // How far the analyzer moves between frames: 0 for whatever arrives
+    // between frames, or n for an FFT's length / 2^n, but never less than
+    // what arrives between frames, since it draws at most one per frame.
+    std::atomic<float>* analyzerOverlap = processorRef.apvts.getRawParameterValue("Analyzer Overlap");
+
+    struct AnalyzerThread : juce::TimeSliceThread
+    {
+        AnalyzerThread() : juce::TimeSliceThread("PSPVST Analyzer") { startThread(juce::Thread::Priority::low); }
+        ~AnalyzerThread() override { stopThread(1000); }
+    };
+
+    static constexpr int framesPerSecond = 60;
+    static constexpr int analyzerFrameIntervalMs = 1000 / framesPerSecond;
 
-    juce::Atomic<bool> parametersChanged{ false };
+    std::atomic<bool> shouldShowFFTAnalysis{ true };
 
-	MonoChain monoChain;
+    // The analyzer thread's copy of the host rate, and its frame schedule.
+    std::atomic<double> analyzerSampleRate{ 0.0 };
+    juce::uint32 nextAnalyzerFrame = 0;
 
     void updateResponseCurve();
 
     juce::Path responseCurve;
 
-    void updateChain();
-
     void drawBackgroundGrid(juce::Graphics& g);
     void drawTextLabels(juce::Graphics& g);
 
@@ -271,6 +375,10 @@ private:
     juce::Rectangle<int> getAnalysisArea();
 
     PathProducer leftPathProducer, rightPathProducer;
+
+    juce::SharedResourcePointer<AnalyzerThread> analyzerThread;
+
+    int useTimeSlice() override;
 };
 
 class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor
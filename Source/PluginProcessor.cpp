@@ -1,6 +1,30 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    // The kernel table names its entries by sample type; these pick the one for a buffer's.
+    float findPeakMagnitude(const DspKernels& dsp, const float* data, int numSamples)
+    {
+        return dsp.findFloatPeakMagnitude(data, numSamples);
+    }
+
+    double findPeakMagnitude(const DspKernels& dsp, const double* data, int numSamples)
+    {
+        return dsp.findDoublePeakMagnitude(data, numSamples);
+    }
+
+    void crossfade(const DspKernels& dsp, const float* from, const float* to, float* destination, int numSamples)
+    {
+        dsp.crossfadeFloats(from, to, destination, numSamples);
+    }
+
+    void crossfade(const DspKernels& dsp, const double* from, const double* to, double* destination, int numSamples)
+    {
+        dsp.crossfadeDoubles(from, to, destination, numSamples);
+    }
+}
+
 //==============================================================================
 AudioPluginAudioProcessor::AudioPluginAudioProcessor()
     : AudioProcessor(BusesProperties()
@@ -53,7 +77,12 @@ bool AudioPluginAudioProcessor::isMidiEffect() const
 
 double AudioPluginAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load(std::memory_order_relaxed);
+}
+
+juce::AudioProcessorParameter* AudioPluginAudioProcessor::getBypassParameter() const
+{
+    return apvts.getParameter("Bypass");
 }
 
 int AudioPluginAudioProcessor::getNumPrograms()
@@ -89,30 +118,70 @@ void AudioPluginAudioProcessor::prepareToPlay(double sampleRate, int samplesPerB
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
 
-    juce::dsp::ProcessSpec spec;
+    hostSampleRate = sampleRate;
+    requestedOversamplingFactor = getOversamplingFactorParameter();
+    pendingOversamplingFactor = 0;
 
-    spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlock);
+    coefficientDesigner.prepare(sampleRate * requestedOversamplingFactor);
 
-    spec.numChannels = 1;
+    // Ramp over the time between two designs, so a steady sweep moves the
+    // coefficients continuously instead of in steps.
+    designIntervalSamples = juce::roundToInt(sampleRate * CoefficientDesigner::minDesignIntervalMs / 1000.0);
+    samplesSinceDesign = 0;
 
-    spec.sampleRate = sampleRate;
+    auto& mailbox = coefficientDesigner.getAudioMailbox();
+    mailbox.acquire();
+    activeBands.store(::getActiveBands(mailbox.getReadBuffer()), std::memory_order_relaxed);
 
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    linearPhaseActive = linearPhaseParameter->load() > 0.5f;
+    linearPhase.setEnabled(linearPhaseActive);
+    linearPhase.prepare(sampleRate, getTotalNumInputChannels(), samplesPerBlock);
 
-    updateFilters();
+    if (isUsingDoublePrecision())
+        prepareSignalPath(doublePath, samplesPerBlock);
+    else
+        prepareSignalPath(floatPath, samplesPerBlock);
 
-    leftChannelFifo.prepare(samplesPerBlock);
-    rightChannelFifo.prepare(samplesPerBlock);
+    setLatencySamples(getActiveLatencySamples());
+    bypassed = bypassParameter->load() > 0.5f;
+    warmingUp = false;
+
+    updateTail();
+    silentSamples = 0;
+    sleeping = false;
 
     osc.initialise([](float x) { return std::sin(x); });
 
+    juce::dsp::ProcessSpec spec;
+    spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlock);
     spec.numChannels = getTotalNumOutputChannels();
+    spec.sampleRate = sampleRate;
     osc.prepare(spec);
     osc.setFrequency(440);
 
 }
 
+template<typename SampleType>
+void AudioPluginAudioProcessor::prepareSignalPath(SignalPath<SampleType>& path, int samplesPerBlock)
+{
+    // One channel runs a single chain on the block engine, unless the Mono
+    // Engine parameter asks for the interleaved one; anything wider is spread
+    // across SIMD lanes, several channels per instruction.
+    path.cascade.setMonoKernel(getMonoKernelParameter<SampleType>());
+    path.cascade.setOversamplingFactor(requestedOversamplingFactor);
+    path.cascade.prepare(getTotalNumInputChannels(), samplesPerBlock);
+    path.cascade.setCoefficients(coefficientDesigner.getAudioMailbox().getReadBuffer());
+
+    path.transitionBuffer.setSize(getTotalNumInputChannels(), samplesPerBlock);
+
+    // Room for the longest warm-up or latency, and a block on top.
+    const auto maxLatency = juce::jmax(linearPhase.getLatencySamples(),
+                                       (int)std::ceil(getOversamplingLatency(maxOversamplingFactor)));
+    const auto maxWarmUp = juce::jmax(linearPhase.getTailSamples(),
+                                      (int)std::ceil(maxWarmUpSeconds * hostSampleRate));
+    path.inputHistory.prepare(getTotalNumInputChannels(), juce::jmax(maxLatency, maxWarmUp) + samplesPerBlock);
+}
+
 void AudioPluginAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
@@ -125,17 +194,16 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported(const BusesLayout& layout
     juce::ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout works, from mono through 7.1.4 to higher-order ambisonics:
+    // the cascade filters every channel with the same coefficients, so all it
+    // needs is the same channels going out as coming in.
+    const auto& outputs = layouts.getMainOutputChannelSet();
+
+    if (outputs.isDisabled())
         return false;
 
-    // This checks if the input layout matches the output layout
 #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    if (outputs != layouts.getMainInputChannelSet())
         return false;
 #endif
 
@@ -143,11 +211,43 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported(const BusesLayout& layout
 #endif
 }
 
+bool AudioPluginAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
 void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
                                              juce::MidiBuffer& midiMessages)
 {
     juce::ignoreUnused(midiMessages);
+    processBuffer(buffer, bypassParameter->load() > 0.5f);
+}
+
+void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer,
+                                             juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    processBuffer(buffer, bypassParameter->load() > 0.5f);
+}
+
+void AudioPluginAudioProcessor::processBlockBypassed(juce::AudioBuffer<float>& buffer,
+                                                     juce::MidiBuffer& midiMessages)
+{
+    // Hosts that bypass without the parameter get the same latency-compensated pass-through.
+    juce::ignoreUnused(midiMessages);
+    processBuffer(buffer, true);
+}
+
+void AudioPluginAudioProcessor::processBlockBypassed(juce::AudioBuffer<double>& buffer,
+                                                     juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    processBuffer(buffer, true);
+}
 
+template<typename SampleType>
+void AudioPluginAudioProcessor::processBuffer(juce::AudioBuffer<SampleType>& buffer, bool bypassRequested)
+{
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -161,144 +261,403 @@ void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    updateFilters();
+    // An offline render can run far ahead of the design thread, so it designs
+    // its own changes rather than filtering with stale coefficients, at the
+    // same rate in audio time as the thread does in real time.
+    if (isNonRealtime())
+    {
+        samplesSinceDesign += buffer.getNumSamples();
 
-    juce::dsp::AudioBlock<float> block(buffer);
+        if (samplesSinceDesign >= designIntervalSamples)
+        {
+            coefficientDesigner.designPendingChanges();
+            samplesSinceDesign = 0;
+        }
+    }
 
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    // A new factor is only asked for here; the cascade switches once the
+    // designer has sent coefficients for the new rate.
+    const auto oversamplingFactor = getOversamplingFactorParameter();
 
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    if (oversamplingFactor != requestedOversamplingFactor)
+    {
+        requestedOversamplingFactor = oversamplingFactor;
+        coefficientDesigner.setDesignRate(hostSampleRate * oversamplingFactor);
+    }
 
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    auto& path = getSignalPath<SampleType>();
+    auto& cascade = path.cascade;
+    auto& transitionBuffer = path.transitionBuffer;
+    auto& inputHistory = path.inputHistory;
 
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+    auto& mailbox = coefficientDesigner.getAudioMailbox();
+    SampleType cascadeStartGain = 1, cascadeEndGain = 1;
 
-}
+    if (pendingOversamplingFactor != 0)
+    {
+        // The last block faded out, so the change of rate and delay happens in silence.
+        cascade.reset();
+        cascade.setOversamplingFactor(pendingOversamplingFactor);
+        cascade.setCoefficients(mailbox.getReadBuffer());
+        activeBands.store(::getActiveBands(mailbox.getReadBuffer()), std::memory_order_relaxed);
+        pendingOversamplingFactor = 0;
+
+        setLatencySamples(getActiveLatencySamples());
+        updateTail();
+        cascadeStartGain = 0;
+    }
+    else if (mailbox.acquire())
+    {
+        const auto& coefficients = mailbox.getReadBuffer();
+        const auto designFactor = juce::roundToInt(coefficients.sampleRate / hostSampleRate);
+
+        if (designFactor != cascade.getOversamplingFactor())
+        {
+            pendingOversamplingFactor = designFactor;
+            cascadeEndGain = 0;
+        }
+        else
+        {
+            cascade.setCoefficients(coefficients, designIntervalSamples * designFactor);
+            activeBands.store(::getActiveBands(coefficients), std::memory_order_relaxed);
+            updateTail();
+        }
+    }
 
-//==============================================================================
-bool AudioPluginAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
+    // The mono engine coming in starts from silence, so when the cascade is
+    // being heard it fades out for a block first and back in on the new one.
+    const auto monoKernel = getMonoKernelParameter<SampleType>();
 
-juce::AudioProcessorEditor* AudioPluginAudioProcessor::createEditor()
-{
-    return new AudioPluginAudioProcessorEditor(*this);
-    // return new juce::GenericAudioProcessorEditor(*this);
+    if (pendingMonoKernel)
+    {
+        cascade.reset();
+        cascade.setMonoKernel(monoKernel);
+        pendingMonoKernel = false;
+        cascadeStartGain = 0;
+    }
+    else if (monoKernel != cascade.getMonoKernel())
+    {
+        if (totalNumInputChannels == 1 && !bypassed && !linearPhaseActive)
+        {
+            pendingMonoKernel = true;
+            cascadeEndGain = 0;
+        }
+        else
+            cascade.setMonoKernel(monoKernel);
+    }
+
+    const auto numChannels = juce::jmin(totalNumInputChannels, buffer.getNumChannels());
+    const auto numSamples = buffer.getNumSamples();
+    const bool fitsTransition = numSamples <= transitionBuffer.getNumSamples() && numChannels <= transitionBuffer.getNumChannels();
+    const auto& dsp = getDspKernels();
+
+    auto* taskRunner = isNonRealtime() && numSamples >= minParallelBlockSize ? &renderWorkers : nullptr;
+    cascade.setTaskRunner(taskRunner);
+    linearPhase.setTaskRunner(taskRunner);
+
+    inputHistory.push(buffer.getArrayOfReadPointers(), numChannels, numSamples);
+
+    // A factor change fades the cascade out for a block and back in for the
+    // next; bypass holds on until that's over instead of coming back mid-fade.
+    const bool bypass = bypassRequested || (bypassed && pendingOversamplingFactor != 0);
+    const bool enteringBypass = bypass && !bypassed;
+
+    // Stays bypassed until the filters have warmed up.
+    if (bypass)
+    {
+        bypassed = true;
+        warmingUp = false;
+    }
+    else if (bypassed && !warmingUp)
+    {
+        cascade.reset();
+        linearPhase.reset();
+        warmingUp = true;
+        warmUpLag = warmUpSamples;
+    }
+
+    const bool linearPhaseRequested = linearPhaseParameter->load() > 0.5f;
+    linearPhase.setEnabled(linearPhaseRequested);
+
+    bool crossfaded = false;
+
+    if (linearPhaseRequested != linearPhaseActive)
+    {
+        // Linear phase picks up from the recent input rather than coming in a
+        // latency's worth of silence late; bypassed, the warm-up sees to that
+        // instead. The cascade has next to no latency and starts from silence.
+        // This block crossfades over to the new mode. The two differ by the
+        // FIR's latency, so there is no seamless switch, but there is no
+        // click or gap either.
+        linearPhaseActive = linearPhaseRequested;
+        setLatencySamples(getActiveLatencySamples());
+        updateTail();
+
+        if (linearPhaseActive && !bypassed)
+            primeLinearPhase(path, numChannels, numSamples);
+        else if (linearPhaseActive)
+            linearPhase.reset();
+        else
+            cascade.reset();
+
+        // The new mode has its own warm-up to do.
+        if (warmingUp)
+            warmUpLag = warmUpSamples;
+
+        // Bypassed, or warming up to leave bypass, nothing is heard of the old mode.
+        crossfaded = fitsTransition && !bypassed;
+
+        if (crossfaded)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                transitionBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+            if (linearPhaseActive)
+            {
+                cascade.process(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+                linearPhase.process(transitionBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+            }
+            else
+            {
+                linearPhase.process(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+                cascade.process(transitionBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+            }
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                crossfade(dsp, buffer.getReadPointer(channel), transitionBuffer.getReadPointer(channel),
+                          buffer.getWritePointer(channel), numSamples);
+        }
+    }
+
+    const bool leavingBypass = bypassed && warmingUp && warmUpFilters(path, numChannels, numSamples);
+
+    if (bypassed && !enteringBypass && !leavingBypass)
+    {
+        const auto latency = getLatencySamples();
+
+        if (latency > 0)
+            inputHistory.read(buffer.getArrayOfWritePointers(), numChannels, numSamples, latency);
+
+        return;
+    }
+
+    if (leavingBypass)
+    {
+        bypassed = false;
+        warmingUp = false;
+        cascadeStartGain = 1;
+        silentSamples = 0;
+        sleeping = false;
+    }
+
+    // Silent input, once everything has rung out, needs no filtering: the
+    // output is the silence already in the buffer.
+    bool inputSilent = true;
+
+    for (int channel = 0; channel < numChannels && inputSilent; ++channel)
+        inputSilent = findPeakMagnitude(dsp, buffer.getReadPointer(channel), numSamples) <= 0;
+
+    const bool asleep = inputSilent && silentSamples >= sleepAfterSamples;
+    silentSamples = inputSilent ? juce::jmin(silentSamples + numSamples, sleepAfterSamples) : 0;
+
+    if (!crossfaded)
+    {
+        if (asleep)
+        {
+            // What is left of the state is denormal at most; start again from
+            // exact zeros when the input comes back.
+            if (!sleeping)
+            {
+                cascade.reset();
+                linearPhase.reset();
+            }
+        }
+        else if (linearPhaseActive)
+            linearPhase.process(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+        else
+            cascade.process(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        if (!linearPhaseActive && (! juce::exactlyEqual(cascadeStartGain, SampleType(1)) || ! juce::exactlyEqual(cascadeEndGain, SampleType(1))))
+            for (int channel = 0; channel < numChannels; ++channel)
+                buffer.applyGainRamp(channel, 0, numSamples, cascadeStartGain, cascadeEndGain);
+    }
+
+    sleeping = asleep && !crossfaded;
+
+    if ((enteringBypass || leavingBypass) && fitsTransition)
+    {
+        // The dry signal, delayed by the latency, lines up with the filtered one.
+        inputHistory.read(transitionBuffer.getArrayOfWritePointers(), numChannels, numSamples, getLatencySamples());
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* dry = transitionBuffer.getReadPointer(channel);
+            auto* wet = buffer.getWritePointer(channel);
+
+            if (enteringBypass)
+                crossfade(dsp, wet, dry, wet, numSamples);
+            else
+                crossfade(dsp, dry, wet, wet, numSamples);
+        }
+    }
+
+    // With fewer channels than taps (mono, say) the missing ones show the
+    // last channel there is rather than reading past the buffer.
+    if (numChannels > 0)
+    {
+        leftChannelSamples.push(buffer.getReadPointer(juce::jmin((int)Channel::Left, numChannels - 1)), numSamples);
+        rightChannelSamples.push(buffer.getReadPointer(juce::jmin((int)Channel::Right, numChannels - 1)), numSamples);
+    }
 }
 
-//==============================================================================
-void AudioPluginAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
+template<typename SampleType>
+bool AudioPluginAudioProcessor::warmUpFilters(SignalPath<SampleType>& path, int numChannels, int numSamples)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data. 
+    // Run the active path over the input it missed while bypassed, in blocks
+    // it was prepared for, so it comes back with the state it would have had.
+    // Each callback runs at most warmUpBlocksPerCallback blocks' worth, which
+    // gains on the input by all but one of them. Returns true once the filters
+    // are level with the start of this block, which is then filtered as usual.
+    const auto chunkSize = path.transitionBuffer.getNumSamples();
 
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    if (numChannels > path.transitionBuffer.getNumChannels() || chunkSize == 0)
+        return true;
+
+    const auto maxSamples = warmUpBlocksPerCallback * numSamples;
+    const bool catchesUp = warmUpLag + numSamples <= maxSamples;
+    const auto count = catchesUp ? warmUpLag : maxSamples;
+
+    for (int done = 0; done < count; done += chunkSize)
+    {
+        const auto num = juce::jmin(chunkSize, count - done);
+        auto* const* channels = path.transitionBuffer.getArrayOfWritePointers();
+
+        path.inputHistory.read(channels, numChannels, num, numSamples + warmUpLag - done - num);
+
+        if (linearPhaseActive)
+            linearPhase.process(channels, numChannels, num);
+        else
+            path.cascade.process(channels, numChannels, num);
+    }
+
+    warmUpLag = catchesUp ? 0 : warmUpLag - count + numSamples;
+    return catchesUp;
 }
 
-void AudioPluginAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+template<typename SampleType>
+void AudioPluginAudioProcessor::primeLinearPhase(SignalPath<SampleType>& path, int numChannels, int numSamples)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // The convolver takes the input from before this block, a whole FIR's
+    // worth if the history holds that much, so its output starts where it
+    // would have been instead of a latency's worth of silence. It only does
+    // the work whose output is still to be heard, so this costs a forward
+    // transform or so per partition of history.
+    const auto chunkSize = path.transitionBuffer.getNumSamples();
+
+    if (numChannels > path.transitionBuffer.getNumChannels() || chunkSize == 0)
+    {
+        linearPhase.reset();
+        return;
+    }
 
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if (tree.isValid())
+    const auto count = juce::jmin(linearPhase.getTailSamples(), path.inputHistory.getCapacity() - numSamples);
+    linearPhase.startPriming(count);
+
+    for (int done = 0; done < count; done += chunkSize)
     {
-        apvts.replaceState(tree);
-        updateFilters();
+        const auto num = juce::jmin(chunkSize, count - done);
+        auto* const* channels = path.transitionBuffer.getArrayOfWritePointers();
+
+        path.inputHistory.read(channels, numChannels, num, numSamples + count - done - num);
+        linearPhase.prime(channels, numChannels, num);
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+int AudioPluginAudioProcessor::getOversamplingFactorParameter() const
 {
-    ChainSettings settings;
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LowCut Slope")->load());
-    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HighCut Slope")->load());
+    // "Off", "2x", "4x"
+    return 1 << juce::jlimit(0, 2, juce::roundToInt(oversamplingParameter->load()));
+}
 
-    settings.lowCutBypassed = apvts.getRawParameterValue("LowCut Bypassed")->load() > 0.5f;
-    settings.peakBypassed = apvts.getRawParameterValue("Peak Bypassed")->load() > 0.5f;
-    settings.highCutBypassed = apvts.getRawParameterValue("HighCut Bypassed")->load() > 0.5f;
-    return settings;
+template<typename SampleType>
+typename FilterCascade<SampleType>::MonoKernel AudioPluginAudioProcessor::getMonoKernelParameter() const
+{
+    // "Block", "Interleaved"
+    return monoEngineParameter->load() > 0.5f ? FilterCascade<SampleType>::MonoKernel::interleaved
+                                              : FilterCascade<SampleType>::MonoKernel::blockStateSpace;
 }
 
-Coefficients makePeakFilter (const ChainSettings& chainSettings, double sampleRate)
+int AudioPluginAudioProcessor::getCascadeLatencySamples() const
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-        sampleRate,
-        chainSettings.peakFreq,
-        chainSettings.peakQuality,
-        juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels)
-    );
+    return isUsingDoublePrecision() ? doublePath.cascade.getLatencySamples() : floatPath.cascade.getLatencySamples();
 }
 
-void AudioPluginAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings)
+int AudioPluginAudioProcessor::getActiveLatencySamples() const
 {
+    return linearPhaseActive ? linearPhase.getLatencySamples() : getCascadeLatencySamples();
+}
 
+void AudioPluginAudioProcessor::updateTail()
+{
+    if (hostSampleRate <= 0.0)
+        return;
 
-	auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
+    if (linearPhaseActive)
+    {
+        // A FIR stops dead.
+        sleepAfterSamples = linearPhase.getTailSamples();
+        warmUpSamples = sleepAfterSamples;
+        tailLengthSeconds.store(sleepAfterSamples / hostSampleRate, std::memory_order_relaxed);
+        return;
+    }
 
-    leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
+    const auto& coefficients = coefficientDesigner.getAudioMailbox().getReadBuffer();
+    const auto latencySeconds = getCascadeLatencySamples() / hostSampleRate;
 
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    const auto tail = latencySeconds + getDecayTime(coefficients, reportedTailDecibels);
+    const auto sleepAfter = latencySeconds + getDecayTime(coefficients, sleepDecibels);
+    const auto warmUp = latencySeconds + getDecayTime(coefficients, warmUpDecibels);
 
+    tailLengthSeconds.store(juce::jmin(tail, maxTailSeconds), std::memory_order_relaxed);
+    sleepAfterSamples = (int)std::ceil(juce::jmin(sleepAfter, maxTailSeconds) * hostSampleRate);
+    warmUpSamples = (int)std::ceil(juce::jmin(warmUp, maxWarmUpSeconds) * hostSampleRate);
 }
 
-void updateCoefficients(Coefficients& old, const Coefficients& replacements)
+//==============================================================================
+bool AudioPluginAudioProcessor::hasEditor() const
 {
-    *old = *replacements;
+    return true; // (change this to false if you choose to not supply an editor)
 }
 
-void AudioPluginAudioProcessor::updateLowCutFilter(const ChainSettings& chainSettings)
+juce::AudioProcessorEditor* AudioPluginAudioProcessor::createEditor()
 {
-	auto cutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
-
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    updateCutFilter(leftLowCut, cutCoefficients, chainSettings.lowCutSlope);
-
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
-    updateCutFilter(rightLowCut, cutCoefficients, chainSettings.lowCutSlope);
-
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    return new AudioPluginAudioProcessorEditor(*this);
+    // return new juce::GenericAudioProcessorEditor(*this);
 }
 
-void AudioPluginAudioProcessor::updateHighCutFilter(const ChainSettings& chainSettings)
+//==============================================================================
+void AudioPluginAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-	auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
-
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    // You should use this method to store your parameters in the memory block.
+    // You could do that either as raw data, or use the XML or ValueTree classes
+    // as intermediaries to make it easy to save and load complex data. 
 
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    juce::MemoryOutputStream mos(destData, true);
+    apvts.state.writeToStream(mos);
 }
 
-void AudioPluginAudioProcessor::updateFilters()
+void AudioPluginAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    auto chainSettings = getChainSettings(apvts);
+    // You should use this method to restore your parameters from this memory block,
+    // whose contents will have been created by the getStateInformation() call.
 
-    updatePeakFilter(chainSettings);
-    updateLowCutFilter(chainSettings);
-    updateHighCutFilter(chainSettings);
+    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
+    // replaceState() notifies the coefficient designer of every value that
+    // differs, so the new bands reach the audio thread on their own.
+    if (tree.isValid())
+        apvts.replaceState(tree);
 }
 
-
 juce::AudioProcessorValueTreeState::ParameterLayout
 AudioPluginAudioProcessor::createParameterLayout()
 {
@@ -354,6 +713,46 @@ AudioPluginAudioProcessor::createParameterLayout()
     layout.add(std::make_unique<juce::AudioParameterBool>("Peak Bypassed", "Peak Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("HighCut Bypassed", "HighCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("Analyzer Enabled", "Analyzer Enabled", true));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Linear Phase", "Linear Phase", false));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling",
+                                                            "Oversampling",
+                                                            juce::StringArray{ "Off", "2x", "4x" },
+                                                            0));
+
+    layout.add(std::make_unique<juce::AudioParameterBool>("Bypass", "Bypass", false));
+
+    // The analyzer's FFT size; every one is ready to go, so it can change while running.
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Resolution",
+                                                            "Analyzer Resolution",
+                                                            juce::StringArray{ "2048", "4096", "8192" },
+                                                            0));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Peak Design",
+                                                            "Peak Design",
+                                                            juce::StringArray{ "Bilinear", "Matched" },
+                                                            0));
+
+    // The state-variable form costs a little more but behaves under fast automation.
+    const juce::StringArray topologies{ "Biquad", "SVF" };
+    layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Topology", "LowCut Topology", topologies, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Peak Topology", "Peak Topology", topologies, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Topology", "HighCut Topology", topologies, 0));
+
+    // How much each analyzer frame overlaps the last. "Frame Rate" moves on by
+    // what arrives between display frames; the others by a fraction of the FFT,
+    // or by the frame rate's hop if that fraction would be shorter.
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Overlap",
+                                                            "Analyzer Overlap",
+                                                            juce::StringArray{ "Frame Rate", "50%", "75%", "87.5%" },
+                                                            0));
+
+    // What a mono cascade runs on: the block state-space engine, or the
+    // multichannel one with a single lane in use, to compare against.
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Mono Engine",
+                                                            "Mono Engine",
+                                                            juce::StringArray{ "Block", "Interleaved" },
+                                                            0));
 
     return layout;
 }
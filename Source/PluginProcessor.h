@@ -4,69 +4,14 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 
-#include <array>
-template<typename T>
-struct Fifo
-{
-    void prepare(int numChannels, int numSamples)
-    {
-        static_assert(std::is_same_v<T, juce::AudioBuffer<float>>,
-                      "prepare(numChannels, numSamples) should only be used when the Fifo is holding juce::AudioBuffer<float>");
-        for (auto& buffer : buffers)
-        {
-            buffer.setSize(numChannels,
-                           numSamples,
-                           false,   //clear everything?
-                           true,    //including the extra space?
-                           true);   //avoid reallocating if you can?
-            buffer.clear();
-        }
-    }
+#include "CoefficientDesigner.h"
+#include "FilterCascade.h"
+#include "InputHistory.h"
+#include "LinearPhaseEq.h"
+#include "RenderWorkers.h"
+#include "SampleRing.h"
 
-    void prepare(size_t numElements)
-    {
-        static_assert(std::is_same_v<T, std::vector<float>>,
-                      "prepare(numElements) should only be used when the Fifo is holding std::vector<float>");
-        for (auto& buffer : buffers)
-        {
-            buffer.clear();
-            buffer.resize(numElements, 0);
-        }
-    }
-
-    bool push(const T& t)
-    {
-        auto write = fifo.write(1);
-        if (write.blockSize1 > 0)
-        {
-            buffers[write.startIndex1] = t;
-            return true;
-        }
-
-        return false;
-    }
-
-    bool pull(T& t)
-    {
-        auto read = fifo.read(1);
-        if (read.blockSize1 > 0)
-        {
-            t = buffers[read.startIndex1];
-            return true;
-        }
-
-        return false;
-    }
-
-    int getNumAvailableForReading() const
-    {
-        return fifo.getNumReady();
-    }
-private:
-    static constexpr int Capacity = 30;
-    std::array<T, Capacity> buffers;
-    juce::AbstractFifo fifo{ Capacity };
-};
+#include <atomic>
 
 enum Channel
 {
@@ -74,181 +19,6 @@ enum Channel
     Left //effectively 1
 };
 
-template<typename BlockType>
-struct SingleChannelSampleFifo
-{
-    SingleChannelSampleFifo(Channel ch) : channelToUse(ch)
-    {
-        prepared.set(false);
-    }
-
-    void update(const BlockType& buffer)
-    {
-        jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse);
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
-
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
-        {
-            pushNextSampleIntoFifo(channelPtr[i]);
-        }
-    }
-
-    void prepare(int bufferSize)
-    {
-        prepared.set(false);
-        size.set(bufferSize);
-
-        bufferToFill.setSize(1,             //channel
-                             bufferSize,    //num samples
-                             false,         //keepExistingContent
-                             true,          //clear extra space
-                             true);         //avoid reallocating
-        audioBufferFifo.prepare(1, bufferSize);
-        fifoIndex = 0;
-        prepared.set(true);
-    }
-    //==============================================================================
-    int getNumCompleteBuffersAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
-    bool isPrepared() const { return prepared.get(); }
-    int getSize() const { return size.get(); }
-    //==============================================================================
-    bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
-private:
-    Channel channelToUse;
-    int fifoIndex = 0;
-    Fifo<BlockType> audioBufferFifo;
-    BlockType bufferToFill;
-    juce::Atomic<bool> prepared = false;
-    juce::Atomic<int> size = 0;
-
-    void pushNextSampleIntoFifo(float sample)
-    {
-        if (fifoIndex == bufferToFill.getNumSamples())
-        {
-            auto ok = audioBufferFifo.push(bufferToFill);
-
-            juce::ignoreUnused(ok);
-
-            fifoIndex = 0;
-        }
-
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
-    }
-};
-
-enum class Slope
-{
-    slope12dBPerOctave,
-    slope24dBPerOctave, 
-    slope36dBPerOctave,
-    slope48dBPerOctave
-};
-
-struct ChainSettings {
-    float lowCutFreq{ 20.f };
-    float highCutFreq{ 20000.f };
-    float peakFreq{ 750.f };
-    float peakGainInDecibels{ 0.0f };
-    float peakQuality{ 1.0f };
-    
-    Slope lowCutSlope{ Slope::slope12dBPerOctave };
-    Slope highCutSlope{ Slope::slope12dBPerOctave };
-
-    bool lowCutBypassed{ false }, peakBypassed{ false }, highCutBypassed{ false };
-};
-
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
-
-using Filter = juce::dsp::IIR::Filter<float>;
-
-using CutFilter = juce::dsp::ProcessorChain<
-    Filter,
-    Filter,
-    Filter,
-    Filter
->;
-
-using MonoChain = juce::dsp::ProcessorChain<
-    CutFilter, // LowCut
-    Filter,    // Peak
-    CutFilter  // HighCut
->;
-
-enum ChainPositions
-{   
-    LowCut,
-    Peak,
-    HighCut
-};
-
-using Coefficients = Filter::CoefficientsPtr;
-void updateCoefficients(Coefficients& old, const Coefficients& replacements);
-
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
-
-using Coefficients = Filter::CoefficientsPtr;
-
-template<int Index, typename ChainType, typename CoefficientType>
-void update(ChainType& chain, const CoefficientType& coefficients)
-{
-    updateCoefficients(chain.template get<Index>().coefficients, coefficients[Index]);
-    chain.template setBypassed<Index>(false);
-}
-
-
-template<typename ChainType, typename CoefficientType>
-void updateCutFilter(ChainType& chain, const CoefficientType& coefficients, const Slope& slope)
-{
-
-    chain.template setBypassed<0>(true);
-    chain.template setBypassed<1>(true);
-    chain.template setBypassed<2>(true);
-    chain.template setBypassed<3>(true);
-
-    switch (slope)
-    {
-    case Slope::slope48dBPerOctave:
-    {
-        update<3>(chain, coefficients);
-
-        }
-
-    case Slope::slope36dBPerOctave:
-    {
-        update<2>(chain, coefficients);
-
-        }
-
-    case Slope::slope24dBPerOctave:
-    {
-        update<1>(chain, coefficients);
-
-        }
-
-    case Slope::slope12dBPerOctave:
-    {
-        update<0>(chain, coefficients);
-
-        }
-    }
-}
-
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
-{
-    return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
-                                                                                       sampleRate,
-																					   2 * (static_cast<int>(chainSettings.lowCutSlope) + 1));
-}
-
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
-{
-    return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq,
-                                                                                      sampleRate,
-																					  2 * (static_cast<int>(chainSettings.highCutSlope) + 1));
-}
-
 //==============================================================================
 class AudioPluginAudioProcessor : public juce::AudioProcessor
 {
@@ -264,7 +34,14 @@ public:
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-    using AudioProcessor::processBlock;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+    /** Every path runs at either precision, so 64-bit hosts need no conversion around it. */
+    bool supportsDoublePrecisionProcessing() const override;
+
+    juce::AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -295,22 +72,119 @@ public:
 
 	juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "PARAMETERS", createParameterLayout() };
 
-    using BlockType = juce::AudioBuffer<float>;
-    SingleChannelSampleFifo<BlockType> leftChannelFifo{ Channel::Left };
-    SingleChannelSampleFifo<BlockType> rightChannelFifo{ Channel::Right };
+    CoefficientDesigner coefficientDesigner{ apvts };
+
+    /** ActiveBand flags for the bands the audio thread is filtering with; flat and bypassed ones cost nothing. */
+    int getActiveBands() const { return activeBands.load(std::memory_order_relaxed); }
+
+    /** What the analyzer reads; the audio thread writes every block into both. */
+    SampleRing leftChannelSamples, rightChannelSamples;
 
 
 private:
     //==============================================================================
-	MonoChain leftChain, rightChain;
+    /**
+     What runs at the host's sample precision. Only the path for the precision
+     the host has asked for is prepared.
+     */
+    template<typename SampleType>
+    struct SignalPath
+    {
+        FilterCascade<SampleType> cascade;
+
+        // Room for both modes' output of one block while switching between
+        // them, or for the dry signal while bypass crossfades.
+        juce::AudioBuffer<SampleType> transitionBuffer;
+
+        InputHistory<SampleType> inputHistory;
+    };
+
+    SignalPath<float> floatPath;
+    SignalPath<double> doublePath;
+
+    template<typename SampleType>
+    SignalPath<SampleType>& getSignalPath()
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doublePath;
+        else
+            return floatPath;
+    }
+
+    template<typename SampleType>
+    void prepareSignalPath(SignalPath<SampleType>& path, int samplesPerBlock);
+
+    int designIntervalSamples = 0;
+    int samplesSinceDesign = 0;
+
+    LinearPhaseEq linearPhase{ coefficientDesigner.getLinearPhaseMailbox() };
+    std::atomic<float>* linearPhaseParameter = apvts.getRawParameterValue("Linear Phase");
+    bool linearPhaseActive = false;
+
+    std::atomic<float>* oversamplingParameter = apvts.getRawParameterValue("Oversampling");
+    double hostSampleRate = 0.0;
+    int requestedOversamplingFactor = 1;
+
+    // Set when a block has faded out ahead of a new factor; the next one
+    // switches to it and fades back in.
+    int pendingOversamplingFactor = 0;
+
+    // A mono cascade changes engine the same way.
+    std::atomic<float>* monoEngineParameter = apvts.getRawParameterValue("Mono Engine");
+    bool pendingMonoKernel = false;
+
+    int getOversamplingFactorParameter() const;
+    template<typename SampleType>
+    typename FilterCascade<SampleType>::MonoKernel getMonoKernelParameter() const;
+    int getCascadeLatencySamples() const;
+    int getActiveLatencySamples() const;
+
+    // What the host is told is the time to fall by 120 dB. The filters sleep
+    // through silent input once they have had long enough to fall from full
+    // scale, plus the peak's boost, below the smallest normal float.
+    static constexpr double reportedTailDecibels = -120.0;
+    static constexpr double sleepDecibels = -800.0;
+    static constexpr double maxTailSeconds = 60.0;
+
+    std::atomic<double> tailLengthSeconds{ 0.0 };
+    std::atomic<int> activeBands{ 0 };
+    int sleepAfterSamples = 0, silentSamples = 0;
+    bool sleeping = false;
+
+    void updateTail();
+
+    // Bypass passes the input through delayed by the latency, without touching
+    // the filters or the analyzer. Going in or out crossfades over one block.
+    // Coming back, the filters first run over the last warmUpSamples of input:
+    // the -60 dB decay for the cascade, capped at maxWarmUpSeconds, or the
+    // whole FIR for linear phase. They catch up a few blocks' worth per
+    // callback while the dry signal carries on, so no one callback pays for
+    // all of it, and fade in once they are level with the input.
+    static constexpr double warmUpDecibels = -60.0;
+    static constexpr double maxWarmUpSeconds = 0.25;
+    static constexpr int warmUpBlocksPerCallback = 4;
+
+    std::atomic<float>* bypassParameter = apvts.getRawParameterValue("Bypass");
+    bool bypassed = false, warmingUp = false;
+    int warmUpSamples = 0;
+
+    // While warming up, how far behind the start of the current block the filters are.
+    int warmUpLag = 0;
+
+    // Offline, blocks at least this long spread their channels over the
+    // render workers. The output is bit-identical to the real-time path.
+    static constexpr int minParallelBlockSize = 1024;
+
+    RenderWorkers renderWorkers;
 
-	void updatePeakFilter(const ChainSettings& chainSettings);
-	
+    template<typename SampleType>
+    void processBuffer(juce::AudioBuffer<SampleType>& buffer, bool bypassRequested);
 
-	void updateLowCutFilter(const ChainSettings& chainSettings);
-	void updateHighCutFilter(const ChainSettings& chainSettings);
+    template<typename SampleType>
+    bool warmUpFilters(SignalPath<SampleType>& path, int numChannels, int numSamples);
 
-	void updateFilters();
+    template<typename SampleType>
+    void primeLinearPhase(SignalPath<SampleType>& path, int numChannels, int numSamples);
     
     juce::dsp::Oscillator<float> osc;
 
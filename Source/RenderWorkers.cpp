@@ -0,0 +1,67 @@
+#include "RenderWorkers.h"
+
+RenderWorkers::~RenderWorkers()
+{
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->notify();
+    }
+
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+}
+
+void RenderWorkers::run(int newNumTasks, void (*task)(void*, int), void* context)
+{
+    if (workers.empty())
+    {
+        const auto numWorkers = juce::jlimit(0, maxWorkers, juce::SystemStats::getNumCpus() - 1);
+
+        for (int i = 0; i < numWorkers; ++i)
+        {
+            workers.push_back(std::make_unique<Worker>(*this));
+            workers.back()->startThread();
+        }
+    }
+
+    currentTask = task;
+    currentContext = context;
+    numTasks = newNumTasks;
+    nextTask.store(0);
+    finished.reset();
+
+    // The caller takes a share too, so one task fewer than there are is enough help.
+    const auto numToWake = juce::jmin((int)workers.size(), newNumTasks - 1);
+    busyWorkers.store(numToWake);
+
+    for (int i = 0; i < numToWake; ++i)
+        workers[(size_t)i]->notify();
+
+    runTasks();
+
+    if (numToWake > 0)
+        finished.wait();
+}
+
+void RenderWorkers::runTasks()
+{
+    for (auto index = nextTask.fetch_add(1); index < numTasks; index = nextTask.fetch_add(1))
+        currentTask(currentContext, index);
+}
+
+void RenderWorkers::Worker::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        if (threadShouldExit())
+            return;
+
+        owner.runTasks();
+
+        if (owner.busyWorkers.fetch_sub(1) == 1)
+            owner.finished.signal();
+    }
+}
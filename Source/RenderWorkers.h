@@ -0,0 +1,51 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include "DspKernels.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ A few threads for an offline render to spread its channels across.
+
+ They start the first time there is work, so a plugin that never renders
+ offline never has them. Every thread, the caller included, takes the next
+ task from one shared counter until none are left, so whichever finishes
+ first simply picks up more. run() waits for every thread it woke to check
+ back in before returning, so nothing is still looking at a finished run
+ when the next begins.
+ */
+class RenderWorkers : public TaskRunner
+{
+public:
+    RenderWorkers() = default;
+    ~RenderWorkers() override;
+
+    void run(int numTasks, void (*task)(void* context, int index), void* context) override;
+private:
+    struct Worker : juce::Thread
+    {
+        explicit Worker(RenderWorkers& pool) : juce::Thread("PSPVST Render Worker"), owner(pool) {}
+        void run() override;
+
+        RenderWorkers& owner;
+    };
+
+    static constexpr int maxWorkers = 7;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // The run in progress, written before any worker is woken for it.
+    void (*currentTask)(void*, int) = nullptr;
+    void* currentContext = nullptr;
+    int numTasks = 0;
+    std::atomic<int> nextTask{ 0 }, busyWorkers{ 0 };
+    juce::WaitableEvent finished;
+
+    void runTasks();
+
+    JUCE_DECLARE_NON_COPYABLE(RenderWorkers)
+};
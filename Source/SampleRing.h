@@ -0,0 +1,70 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <vector>
+
+/**
+ The analyzer's tap on one channel: a single-producer / single-consumer ring of
+ raw float samples.
+
+ The audio thread pushes each block with one or two copies, whatever its size,
+ and the analyzer pulls however many samples it wants straight out of the
+ ring. The storage is allocated once, up front, so neither side ever waits
+ for the other or for the allocator. When the analyzer falls behind by more
+ than the capacity, the newest samples are dropped until it catches up.
+ */
+struct SampleRing
+{
+    /** About 0.7 s at 48 kHz: room for the largest analyzer FFT plus a stalled message thread. */
+    static constexpr int capacity = 1 << 15;
+
+    SampleRing() : samples((size_t)capacity) {}
+
+    /** Producer only. Float or double; the analyzer works in float either way. */
+    template<typename SampleType>
+    void push(const SampleType* source, int numSamples)
+    {
+        auto write = fifo.write(numSamples);
+
+        copy(source, samples.data() + write.startIndex1, write.blockSize1);
+        copy(source + write.blockSize1, samples.data() + write.startIndex2, write.blockSize2);
+    }
+
+    /** Consumer only. */
+    int getNumReady() const { return fifo.getNumReady(); }
+
+    /** Consumer only. Copies up to numSamples of the oldest unread samples and returns how many there were. */
+    int pull(float* destination, int numSamples)
+    {
+        auto read = fifo.read(juce::jmin(numSamples, fifo.getNumReady()));
+
+        juce::FloatVectorOperations::copy(destination, samples.data() + read.startIndex1, read.blockSize1);
+        juce::FloatVectorOperations::copy(destination + read.blockSize1, samples.data() + read.startIndex2, read.blockSize2);
+
+        return read.blockSize1 + read.blockSize2;
+    }
+
+    /** Consumer only. Drops up to numSamples of the oldest unread samples without reading them. */
+    void discard(int numSamples)
+    {
+        fifo.finishedRead(juce::jmin(numSamples, fifo.getNumReady()));
+    }
+private:
+    std::vector<float> samples;
+    juce::AbstractFifo fifo{ capacity };
+
+    static void copy(const float* source, float* destination, int numSamples)
+    {
+        juce::FloatVectorOperations::copy(destination, source, numSamples);
+    }
+
+    static void copy(const double* source, float* destination, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            destination[i] = static_cast<float>(source[i]);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE(SampleRing)
+};
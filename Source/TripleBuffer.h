@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+/**
+ A wait-free single-producer / single-consumer mailbox that always hands the
+ consumer the most recently published value.
+
+ The producer fills getWriteBuffer() and calls publish(); the consumer calls
+ acquire() and reads getReadBuffer(). Neither side ever blocks or copies: the
+ three slots just change owner by swapping an index, so a snapshot stays
+ immutable for as long as the consumer holds it. Anything published but not
+ yet acquired is replaced by the next publish().
+ */
+template<typename T>
+struct TripleBuffer
+{
+    /** Producer only. The slot to fill before calling publish(). */
+    T& getWriteBuffer() noexcept { return buffers[(size_t)writeIndex]; }
+
+    /** Producer only. Hands the write slot over to the consumer. */
+    void publish() noexcept
+    {
+        auto previous = shared.exchange(writeIndex | freshFlag, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    /** Consumer only. Swaps in the newest published slot, returning false if nothing new arrived. */
+    bool acquire() noexcept
+    {
+        if ((shared.load(std::memory_order_relaxed) & freshFlag) == 0)
+            return false;
+
+        auto previous = shared.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    /** Consumer only. The value most recently acquired. */
+    const T& getReadBuffer() const noexcept { return buffers[(size_t)readIndex]; }
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int freshFlag = 4;
+
+    std::array<T, 3> buffers{};
+    std::atomic<int> shared{ 1 };
+    int writeIndex = 0;
+    int readIndex = 2;
+};
@@ -0,0 +1,31 @@
+#include "FilterCascade.h"
+
+#include <cstdio>
+
+/**
+ Runs the block state-space engine of every instruction set this build has
+ and this CPU can run against juce::dsp::IIR::Filter, and fails if any of
+ them strays further than blockKernelTolerance.
+ */
+int main()
+{
+    SimdInstructionSet instructionSets[numInstructionSets];
+    const auto numAvailable = getAvailableInstructionSets(instructionSets);
+    bool passed = numAvailable > 0;
+
+    for (int i = 0; i < numAvailable; ++i)
+    {
+        forceInstructionSet(instructionSets[i]);
+
+        const auto deviation = getBlockKernelDeviation(getDspKernels());
+        const bool withinTolerance = deviation <= blockKernelTolerance;
+
+        std::printf("%-8s %.3g %s\n", getInstructionSetName(instructionSets[i]), (double)deviation,
+                    withinTolerance ? "ok" : "FAILED");
+
+        passed = passed && withinTolerance;
+    }
+
+    clearForcedInstructionSet();
+    return passed ? 0 : 1;
+}